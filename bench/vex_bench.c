@@ -0,0 +1,251 @@
+/*
+ vex_bench.c
+
+ Measures vex_parse throughput on a few argument shapes. On Linux, hardware counters are read through
+ perf_event_open as well; elsewhere, or when the kernel refuses (perf_event_paranoid, containers), only
+ wall-clock time is reported.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "vex/vex.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define VEX_BENCH_PERF
+#endif
+
+#define NUM_COUNTERS 4
+
+static const char* counter_names[NUM_COUNTERS] = { "cycles", "instructions", "branch-misses", "cache-misses" };
+
+typedef struct {
+	int fd[NUM_COUNTERS];
+	bool enabled;
+} perf_group;
+
+typedef struct {
+	const char* name;
+	vex_ctx ctx;
+	char** argv;
+	int argc;
+	int iterations;
+	bool owns_args;
+} scenario;
+
+static uint64_t clock_ns(void) {
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+	return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+static void perf_open(perf_group* group) {
+	memset(group, 0, sizeof(*group));
+	for (int i = 0; i < NUM_COUNTERS; ++i) group->fd[i] = -1;
+#if defined(VEX_BENCH_PERF)
+	static const uint64_t configs[NUM_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+	};
+	for (int i = 0; i < NUM_COUNTERS; ++i) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.disabled = (i == 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		// Counters are grouped under cycles so they're scheduled on the PMU together
+		int leader = (i == 0) ? -1 : group->fd[0];
+		group->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+		if (group->fd[i] < 0) {
+			fprintf(stderr, "perf_event_open(%s) unavailable, reporting wall-clock time only\n", counter_names[i]);
+			for (int j = 0; j < i; ++j) close(group->fd[j]);
+			for (int j = 0; j < NUM_COUNTERS; ++j) group->fd[j] = -1;
+			return;
+		}
+	}
+	group->enabled = true;
+#endif
+}
+
+static void perf_close(perf_group* group) {
+#if defined(VEX_BENCH_PERF)
+	for (int i = 0; i < NUM_COUNTERS; ++i) {
+		if (group->fd[i] >= 0) close(group->fd[i]);
+	}
+#endif
+	group->enabled = false;
+}
+
+static void perf_start(perf_group* group) {
+#if defined(VEX_BENCH_PERF)
+	if (!group->enabled) return;
+	ioctl(group->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(group->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+	(void)group;
+#endif
+}
+
+static void perf_stop(perf_group* group, uint64_t* counts) {
+	memset(counts, 0, NUM_COUNTERS * sizeof(*counts));
+#if defined(VEX_BENCH_PERF)
+	if (!group->enabled) return;
+	ioctl(group->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	for (int i = 0; i < NUM_COUNTERS; ++i) {
+		if (read(group->fd[i], &counts[i], sizeof(counts[i])) != (ssize_t)sizeof(counts[i])) counts[i] = 0;
+	}
+#else
+	(void)group;
+#endif
+}
+
+static char** make_argv(int argc) {
+	char** argv = (char**)calloc((size_t)argc + 1, sizeof(*argv));
+	if (!argv) exit(1);
+	argv[0] = "bench";
+	return argv;
+}
+
+static char* format_arg(const char* fmt, int num) {
+	char temp[64];
+	snprintf(temp, sizeof(temp), fmt, num);
+	char* str = (char*)malloc(strlen(temp) + 1);
+	if (!str) exit(1);
+	strcpy(str, temp);
+	return str;
+}
+
+static void init_ctx(vex_ctx* ctx) {
+	vex_init_info info = { "bench", "1.0", "vex benchmark", 0 };
+	if (!vex_init(ctx, info)) exit(1);
+}
+
+static void add_option(vex_ctx* ctx, const char* long_name, char short_name, int arg_type, int max_count) {
+	vex_arg_desc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.description = "benchmark option";
+	desc.long_name = (char*)long_name;
+	desc.short_name = short_name;
+	desc.arg_type = arg_type;
+	desc.max_count = max_count;
+	if (!vex_add_arg(ctx, desc)) exit(1);
+}
+
+static void setup_short_clusters(scenario* sc) {
+	// Single letter flags packed together, e.g. -abcdefg
+	static const char* flags = "abcdefgijklmnopqrstuwxyz";
+	static const char* long_names[] = {
+		"a1", "b1", "c1", "d1", "e1", "f1", "g1", "i1", "j1", "k1", "l1", "m1",
+		"n1", "o1", "p1", "q1", "r1", "s1", "t1", "u1", "w1", "x1", "y1", "z1"
+	};
+	static const char* clusters[] = { "-abcdefg", "-ijklmno", "-pqrstu", "-wxyz", "-zyxw", "-gfedcba" };
+	sc->name = "short clusters";
+	init_ctx(&sc->ctx);
+	for (int i = 0; flags[i] != '\0'; ++i) add_option(&sc->ctx, long_names[i], flags[i], VEX_ARG_TYPE_FLAG, 0);
+	sc->argc = 1 + 1000;
+	sc->argv = make_argv(sc->argc);
+	for (int a = 1; a < sc->argc; ++a) sc->argv[a] = (char*)clusters[a % 6];
+	sc->iterations = 200;
+}
+
+static void setup_long_equals(scenario* sc) {
+	// Long options with attached values of every type
+	sc->name = "long --opt=value";
+	init_ctx(&sc->ctx);
+	add_option(&sc->ctx, "count", 'c', VEX_ARG_TYPE_INT, -1);
+	add_option(&sc->ctx, "ratio", 'r', VEX_ARG_TYPE_DUB, -1);
+	add_option(&sc->ctx, "name", 'n', VEX_ARG_TYPE_STR, -1);
+	add_option(&sc->ctx, "output", 'o', VEX_ARG_TYPE_STR, -1);
+	add_option(&sc->ctx, "threads", 't', VEX_ARG_TYPE_INT, -1);
+	sc->argc = 1 + 1000;
+	sc->argv = make_argv(sc->argc);
+	for (int a = 1; a < sc->argc; ++a) {
+		switch (a % 5) {
+		case 0: sc->argv[a] = format_arg("--count=%d", a); break;
+		case 1: sc->argv[a] = format_arg("--ratio=%d.25", a); break;
+		case 2: sc->argv[a] = format_arg("--name=item%d", a); break;
+		case 3: sc->argv[a] = format_arg("--output=/tmp/out%d.txt", a); break;
+		default: sc->argv[a] = format_arg("--threads=%d", a % 64); break;
+		}
+	}
+	sc->owns_args = true;
+	sc->iterations = 200;
+}
+
+static void setup_positionals(scenario* sc) {
+	// One unbounded positional slot swallowing a large file list
+	sc->name = "huge positional list";
+	init_ctx(&sc->ctx);
+	add_option(&sc->ctx, "force", 'f', VEX_ARG_TYPE_FLAG, 0);
+	vex_pos_desc pos;
+	memset(&pos, 0, sizeof(pos));
+	pos.description = "input files";
+	pos.name = "files";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	pos.max_count = -1;
+	if (!vex_add_pos(&sc->ctx, pos)) exit(1);
+	sc->argc = 1 + 100000;
+	sc->argv = make_argv(sc->argc);
+	for (int a = 1; a < sc->argc; ++a) sc->argv[a] = format_arg("src/module%d/file.c", a);
+	sc->owns_args = true;
+	sc->iterations = 5;
+}
+
+static void run(scenario* sc, perf_group* group) {
+	// Warm up caches and allocator before measuring
+	if (!vex_parse(&sc->ctx, sc->argc, sc->argv)) {
+		fprintf(stderr, "%s: parse failed: %s\n", sc->name, sc->ctx.status_msg ? sc->ctx.status_msg : "");
+		exit(1);
+	}
+
+	uint64_t counts[NUM_COUNTERS];
+	uint64_t start = clock_ns();
+	perf_start(group);
+	for (int i = 0; i < sc->iterations; ++i) vex_parse(&sc->ctx, sc->argc, sc->argv);
+	perf_stop(group, counts);
+	uint64_t elapsed = clock_ns() - start;
+
+	double args = (double)(sc->argc - 1) * sc->iterations;
+	printf("%-22s %10.1f ns/arg", sc->name, (double)elapsed / args);
+	if (group->enabled) {
+		for (int i = 0; i < NUM_COUNTERS; ++i) printf("  %8.2f %s", (double)counts[i] / args, counter_names[i]);
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	(void)argc;
+	(void)argv;
+	perf_group group;
+	perf_open(&group);
+	if (group.enabled) printf("Hardware counters are reported per parsed argument\n");
+
+	void (*setups[])(scenario*) = { setup_short_clusters, setup_long_equals, setup_positionals };
+	for (size_t s = 0; s < sizeof(setups) / sizeof(setups[0]); ++s) {
+		scenario sc;
+		memset(&sc, 0, sizeof(sc));
+		setups[s](&sc);
+		run(&sc, &group);
+		vex_free(&sc.ctx);
+		for (int a = 1; sc.owns_args && a < sc.argc; ++a) free(sc.argv[a]);
+		free(sc.argv);
+	}
+	perf_close(&group);
+	return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ vex_getopt_bench.c
+
+ Compares vex_getopt_long with the C library's getopt_long on a large option table and a long argv. Both scan
+ identical copies of argv, and must return the same options and arguments for the timing to count.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+#include "vex/vex.h"
+
+#define NUM_LONG 1000
+#define ITERATIONS 5
+
+static const char* optstring = "abcdefghijklmnopqrstuvwxyzA:B:C:D:E:F:G:H:";
+
+static uint64_t clock_ns(void) {
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+	return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+static char* format_arg(const char* fmt, int num) {
+	char temp[64];
+	snprintf(temp, sizeof(temp), fmt, num);
+	char* str = (char*)malloc(strlen(temp) + 1);
+	if (!str) exit(1);
+	strcpy(str, temp);
+	return str;
+}
+
+static uint64_t mix(uint64_t sum, int ret, int longindex, const char* optarg) {
+	// Order sensitive checksum of everything a caller would look at
+	sum = sum * 31 + (uint64_t)(ret + 1);
+	sum = sum * 31 + (uint64_t)(longindex + 1);
+	for (const char* c = optarg; c && *c; ++c) sum = sum * 31 + (unsigned char)*c;
+	return sum;
+}
+
+static uint64_t run_libc(int argc, char** args, char** scratch, const struct option* longopts) {
+	memcpy(scratch, args, (size_t)argc * sizeof(*args));
+	uint64_t sum = 0;
+	optind = 0;
+	int ret, longindex = -1;
+	while ((ret = getopt_long(argc, scratch, optstring, longopts, &longindex)) != -1) {
+		sum = mix(sum, ret, longindex, optarg);
+		longindex = -1;
+	}
+	return mix(sum, optind, 0, NULL);
+}
+
+static uint64_t run_vex(int argc, char** args, char** scratch, const vex_option* longopts, vex_getopt* state) {
+	memcpy(scratch, args, (size_t)argc * sizeof(*args));
+	uint64_t sum = 0;
+	state->optind = 0;
+	int ret, longindex = -1;
+	while ((ret = vex_getopt_long(state, argc, scratch, optstring, longopts, &longindex)) != -1) {
+		sum = mix(sum, ret, longindex, state->optarg);
+		longindex = -1;
+	}
+	return mix(sum, state->optind, 0, NULL);
+}
+
+static char** build_args(int num_args, bool interleaved) {
+	// Long options in every spelling, short clusters and short values, with operands mixed in or trailing
+	char** args = (char**)calloc((size_t)num_args + 1, sizeof(char*));
+	if (!args) exit(1);
+	args[0] = format_arg("bench", 0);
+	int a = 1;
+	int num_operands = num_args / 6;
+	for (int i = 0; a < num_args; ++i) {
+		int opt = (i * 7919) % NUM_LONG;
+		if (!interleaved && a >= num_args - num_operands) {
+			args[a++] = format_arg("file%d.txt", i);
+			continue;
+		}
+		switch (i % (interleaved ? 6 : 5)) {
+		case 0: args[a++] = format_arg((opt % 3) ? "--option-%04d=value" : "--option-%04d", opt); break;
+		case 1:
+			args[a++] = format_arg("--option-%04d", opt);
+			if (opt % 3 == 1 && a < num_args) args[a++] = format_arg("value", 0);
+			break;
+		case 2: args[a++] = format_arg("-abcdef", 0); break;
+		case 3: args[a++] = format_arg("-Avalue", 0); break;
+		case 4: args[a++] = format_arg("-vxyz", 0); break;
+		default: args[a++] = format_arg("file%d.txt", i); break;
+		}
+	}
+	return args;
+}
+
+static void run(const char* name, int num_args, bool interleaved, const struct option* libc_longopts, const vex_option* vex_longopts) {
+	char** args = build_args(num_args, interleaved);
+	char** scratch = (char**)calloc((size_t)num_args + 1, sizeof(char*));
+	if (!scratch) exit(1);
+
+	vex_getopt state;
+	vex_getopt_init(&state);
+	uint64_t libc_sum = run_libc(num_args, args, scratch, libc_longopts);
+	uint64_t vex_sum = run_vex(num_args, args, scratch, vex_longopts, &state);
+	if (libc_sum != vex_sum) {
+		fprintf(stderr, "%s: vex_getopt_long and getopt_long disagree\n", name);
+		exit(1);
+	}
+
+	uint64_t start = clock_ns();
+	for (int i = 0; i < ITERATIONS; ++i) run_libc(num_args, args, scratch, libc_longopts);
+	uint64_t libc_ns = clock_ns() - start;
+	start = clock_ns();
+	for (int i = 0; i < ITERATIONS; ++i) run_vex(num_args, args, scratch, vex_longopts, &state);
+	uint64_t vex_ns = clock_ns() - start;
+
+	double per_arg = (double)(num_args - 1) * ITERATIONS;
+	printf("%-24s %8d args  getopt_long %10.1f ns/arg  vex_getopt_long %10.1f ns/arg\n",
+		name, num_args - 1, (double)libc_ns / per_arg, (double)vex_ns / per_arg);
+
+	vex_getopt_free(&state);
+	for (int i = 0; i < num_args; ++i) free(args[i]);
+	free(args);
+	free(scratch);
+}
+
+int main(int argc, char** argv) {
+	(void)argc;
+	(void)argv;
+
+	// Same table in both formats, with every kind of argument requirement
+	struct option* libc_longopts = (struct option*)calloc(NUM_LONG + 1, sizeof(struct option));
+	vex_option* vex_longopts = (vex_option*)calloc(NUM_LONG + 1, sizeof(vex_option));
+	if (!libc_longopts || !vex_longopts) return 1;
+	for (int i = 0; i < NUM_LONG; ++i) {
+		char* name = format_arg("option-%04d", i);
+		int has_arg = i % 3;
+		libc_longopts[i].name = name;
+		libc_longopts[i].has_arg = has_arg;
+		libc_longopts[i].val = 1000 + i;
+		vex_longopts[i].name = name;
+		vex_longopts[i].has_arg = has_arg;
+		vex_longopts[i].val = 1000 + i;
+	}
+	printf("%d long options\n", NUM_LONG);
+
+	// Operands between options are permuted to the end, which costs both the same and grows with their number
+	run("trailing operands", 200000, false, libc_longopts, vex_longopts);
+	run("interleaved operands", 20000, true, libc_longopts, vex_longopts);
+
+	for (int i = 0; i < NUM_LONG; ++i) free((char*)libc_longopts[i].name);
+	free(libc_longopts);
+	free(vex_longopts);
+	return 0;
+}
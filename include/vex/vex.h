@@ -22,6 +22,8 @@ extern "C" {
 #include <assert.h>
 #include <ctype.h>
 #include <string.h>
+#include <limits.h>
+#include <stdint.h>
 
 // Pre-C11 function aliases
 #if !defined(__STDC_LIB_EXT1__)
@@ -69,6 +71,39 @@ extern "C" {
 #define VEX_STATUS_BAD_ALLOC 1
 #define VEX_STATUS_BAD_VALUE 2
 #define VEX_STATUS_UNKNOWN_ARG 3
+#define VEX_STATUS_LIMIT_EXCEEDED 4
+#define VEX_STATUS_BAD_UTF8 5
+#define VEX_STATUS_BAD_PATH 6
+
+// Parser flags
+#define VEX_FLAG_PASS_REMAINDER 0x1
+#define VEX_FLAG_PASS_UNKNOWN 0x2
+#define VEX_FLAG_INTERN_STRINGS 0x4
+
+// Descriptor flags
+#define VEX_DESC_UTF8 0x1
+#define VEX_DESC_PATH_EXISTS 0x2
+#define VEX_DESC_PATH_FILE 0x4
+#define VEX_DESC_PATH_DIR 0x8
+#define VEX_DESC_PATH_READABLE 0x10
+#define VEX_DESC_GLOB 0x20
+
+// Kinds of checked paths
+#define VEX_PATH_MISSING 0
+#define VEX_PATH_FILE 1
+#define VEX_PATH_DIR 2
+#define VEX_PATH_OTHER 3
+
+// JSON output flags
+#define VEX_JSON_NDJSON 0x1
+
+// getopt_long argument requirements
+#define VEX_NO_ARGUMENT 0
+#define VEX_REQUIRED_ARGUMENT 1
+#define VEX_OPTIONAL_ARGUMENT 2
+
+// Packed result identifier ("VEXP")
+#define VEX_PACK_MAGIC 0x50584556u
 
 // Memory allocation
 #ifndef VEX_MALLOC
@@ -81,10 +116,40 @@ extern "C" {
 #define VEX_FREE free
 #endif
 
+// Trace hooks, empty unless defined before including the header or VEX_TRACE_USDT is set
+#if defined(VEX_TRACE_USDT)
+#include <sys/sdt.h>
+#ifndef VEX_TRACE_OPTION_RESOLVED
+#define VEX_TRACE_OPTION_RESOLVED(ctx, long_name, short_name) DTRACE_PROBE3(vex, option_resolved, ctx, long_name, (int)(short_name))
+#endif
+#ifndef VEX_TRACE_VALUE_CONVERTED
+#define VEX_TRACE_VALUE_CONVERTED(ctx, arg_type, str) DTRACE_PROBE3(vex, value_converted, ctx, arg_type, str)
+#endif
+#ifndef VEX_TRACE_ALLOC
+#define VEX_TRACE_ALLOC(ctx, ptr, bytes) DTRACE_PROBE3(vex, alloc, ctx, ptr, (size_t)(bytes))
+#endif
+#ifndef VEX_TRACE_ERROR
+#define VEX_TRACE_ERROR(ctx, status, msg) DTRACE_PROBE3(vex, error, ctx, status, msg)
+#endif
+#endif
+#ifndef VEX_TRACE_OPTION_RESOLVED
+#define VEX_TRACE_OPTION_RESOLVED(ctx, long_name, short_name) ((void)0)
+#endif
+#ifndef VEX_TRACE_VALUE_CONVERTED
+#define VEX_TRACE_VALUE_CONVERTED(ctx, arg_type, str) ((void)0)
+#endif
+#ifndef VEX_TRACE_ALLOC
+#define VEX_TRACE_ALLOC(ctx, ptr, bytes) ((void)0)
+#endif
+#ifndef VEX_TRACE_ERROR
+#define VEX_TRACE_ERROR(ctx, status, msg) ((void)0)
+#endif
+
 typedef struct {
 	const char* name;
 	const char* version;
 	const char* description;
+	int flags;
 } vex_init_info;
 
 typedef union {
@@ -99,6 +164,7 @@ typedef struct {
 	vex_value* arg;
 	int arg_count;
 	int arg_type;
+	int arg_capacity;
 } vex_arg_token;
 
 typedef struct {
@@ -107,8 +173,113 @@ typedef struct {
 	char short_name;
 	int arg_type;
 	int max_count;
+	int flags;
 } vex_arg_desc;
 
+typedef struct {
+	char* description;
+	char* name;
+	int arg_type;
+	int max_count;
+	int flags;
+} vex_pos_desc;
+
+typedef struct {
+	uint32_t name_hash;
+	uint32_t name_len;
+	int32_t max_count;
+	int8_t arg_type;
+	char short_name;
+	uint16_t flags;
+} vex_arg_hot;
+
+typedef struct vex_arena_chunk {
+	struct vex_arena_chunk* next;
+	size_t size;
+	size_t used;
+} vex_arena_chunk;
+
+typedef struct {
+	char* str;
+	size_t len;
+	uint32_t hash;
+} vex_intern_entry;
+
+typedef struct {
+	uint64_t args_scanned;
+	uint64_t lookup_probes;
+	uint64_t allocs;
+	uint64_t alloc_bytes;
+	int peak_tokens;
+	int peak_values;
+	uint64_t tokenize_ns;
+	uint64_t lookup_ns;
+	uint64_t convert_ns;
+	uint64_t validate_ns;
+} vex_stats;
+
+typedef struct {
+	int max_args;
+	int max_values;
+	size_t max_arg_len;
+	size_t max_total_bytes;
+} vex_limits;
+
+typedef struct {
+	size_t descriptors;
+	size_t schema_strings;
+	size_t help_cache;
+	size_t tokens;
+	size_t values;
+	size_t string_values;
+	size_t interned;
+	size_t slack;
+	size_t total;
+} vex_memory;
+
+typedef struct {
+	void* block;
+	uint64_t* counters;
+	int num_counters;
+	int num_shards;
+	int stride;
+	unsigned int next_shard;
+} vex_usage;
+
+typedef struct {
+	char* path;
+	char** names;
+	char* chars;
+	size_t capacity_chars;
+	int num_names;
+	uint32_t hash;
+} vex_dir_listing;
+
+typedef struct {
+	const char* path;
+	int token;
+	int value;
+	bool positional;
+	int checks;
+	int kind;
+	int error;
+} vex_path_result;
+
+typedef struct {
+	uint64_t lo;
+	uint64_t hi;
+} vex_hash128;
+
+typedef struct {
+	char* prefix;
+	uint32_t prefix_hash;
+	uint32_t prefix_len;
+	int* members;
+	int num_members;
+	int* index;
+	int capacity_index;
+} vex_group;
+
 typedef struct {
 	char* name;
 	char* help_msg;
@@ -116,105 +287,2587 @@ typedef struct {
 	char* description;
 	char* version;
 	vex_arg_desc* arg_desc;
+	vex_arg_hot* arg_hot;
 	int num_arg_desc;
 	int capacity_arg_desc;
+	int* arg_index;
+	int capacity_arg_index;
+	int16_t short_index[128];
+	vex_group* groups;
+	int num_groups;
+	int capacity_groups;
+	int* group_index;
+	int capacity_group_index;
+	int* free_desc;
+	int num_free_desc;
+	int schema_version;
+	int schema_hash_version;
+	vex_hash128 schema_hash;
+	vex_pos_desc* pos_desc;
+	vex_arg_token* pos_token;
+	int num_pos_desc;
+	int capacity_pos_desc;
 	vex_arg_token* arg_token;
 	int num_arg_token;
 	int capacity_arg_token;
+	char** pass_argv;
+	int pass_argc;
+	bool pass_after_dash;
+	int* pass_index;
+	int capacity_pass_index;
+	vex_path_result* path_results;
+	int num_path_results;
+	int capacity_path_results;
+	vex_dir_listing* dir_cache;
+	int num_dir_cache;
+	int capacity_dir_cache;
+	vex_arena_chunk* arena;
+	vex_arena_chunk* arena_cur;
+	vex_intern_entry* intern;
+	int num_intern;
+	int capacity_intern;
+	vex_arena_chunk* intern_pool;
+	vex_limits limits;
+	vex_usage* usage;
+	uint64_t* usage_shard;
+	int flags;
+	int generation;
 	int status;
+	size_t status_offset;
+#ifdef VEX_ENABLE_STATS
+	vex_stats stats;
+#endif
 } vex_ctx;
 
+typedef struct {
+	int generation;
+	int num_arg_token;
+	int last_desc;
+	int last_token;
+	int last_count;
+	int last_values;
+	int pos_slot;
+	int pos_count;
+	int pos_values;
+	int num_args;
+	size_t total_bytes;
+	int num_path_results;
+	vex_arena_chunk* arena_chunk;
+	size_t arena_used;
+	bool parse_options;
+	bool pass_remainder;
+} vex_checkpoint;
+
+typedef struct {
+	char** argv;
+	int argc;
+	int first;
+	int num_pass;
+	int last_desc;
+	int last_token;
+	int last_count;
+	int pos_slot;
+	int pos_count;
+	int num_args;
+	size_t total_bytes;
+	vex_hash128* hash;
+	bool uses_fs;
+	bool parse_options;
+	bool done;
+} _vex_parse_state;
+
+typedef struct {
+	_vex_parse_state state;
+	int generation;
+	int next_arg;
+	int next_token;
+	int next_slot;
+	bool finished;
+} vex_stream;
+
+typedef struct {
+	vex_arg_token* arg_token;
+	int num_arg_token;
+	vex_arg_token* pos_token;
+	int num_pos_token;
+	char** pass_argv;
+	int pass_argc;
+} vex_result;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t size;
+	int32_t num_arg_token;
+	int32_t num_pos_token;
+	int32_t pass_argc;
+	uint32_t tokens;
+	uint32_t pass_argv;
+	uint32_t reserved;
+} vex_packed_result;
+
+typedef struct {
+	uint32_t long_name;
+	uint32_t arg;
+	int32_t arg_count;
+	int32_t arg_type;
+	char short_name;
+} vex_packed_token;
+
+typedef union {
+	uint32_t str_arg;
+	double dub_arg;
+	int int_arg;
+} vex_packed_value;
+
+typedef struct {
+	char* buffer;
+	size_t capacity;
+	size_t len;
+	size_t total;
+	int fd;
+	bool overflow;
+	bool error;
+} vex_json_writer;
+
+typedef struct {
+	vex_hash128 hash;
+	vex_result* result;
+	int prev;
+	int next;
+	int chain;
+} vex_cache_entry;
+
+typedef struct {
+	vex_cache_entry* entries;
+	int* buckets;
+	int num_buckets;
+	int num_entries;
+	int capacity;
+	int head;
+	int tail;
+	vex_result* uncached;
+} vex_cache;
+
+typedef struct {
+	const char* name;
+	int has_arg;
+	int* flag;
+	int val;
+} vex_option;
+
+typedef struct {
+	const char* name;
+	int index;
+} vex_getopt_entry;
+
+typedef struct {
+	char* optarg;
+	int optind;
+	int opterr;
+	int optopt;
+	char* nextchar;
+	int first_nonopt;
+	int last_nonopt;
+	int ordering;
+	bool missing_colon;
+	bool w_semicolon;
+	bool initialized;
+	const char* optstring;
+	const vex_option* longopts;
+	unsigned char short_table[256];
+	vex_getopt_entry* long_table;
+	int num_long;
+	int capacity_long;
+} vex_getopt;
+
 VEX_API bool vex_init(vex_ctx* ctx, vex_init_info init_info);
 
 VEX_API bool vex_add_arg(vex_ctx* ctx, vex_arg_desc desc);
 
+VEX_API bool vex_add_pos(vex_ctx* ctx, vex_pos_desc desc);
+
+VEX_API int vex_add_group(vex_ctx* ctx, const char* prefix, const vex_arg_desc* descs, int count);
+
+VEX_API bool vex_remove_group(vex_ctx* ctx, int group);
+
+VEX_API void vex_set_limits(vex_ctx* ctx, vex_limits limits);
+
 VEX_API bool vex_parse(vex_ctx* ctx, int argc, char** argv);
 
+VEX_API bool vex_parse_string(vex_ctx* ctx, char* str);
+
+VEX_API bool vex_parse_prefix(vex_ctx* ctx, int argc, char** argv, vex_checkpoint* checkpoint);
+
+VEX_API bool vex_parse_suffix(vex_ctx* ctx, const vex_checkpoint* checkpoint, int argc, char** argv);
+
+VEX_API void vex_stream_begin(vex_ctx* ctx, vex_stream* stream, int argc, char** argv);
+
+VEX_API const vex_arg_token* vex_stream_next(vex_ctx* ctx, vex_stream* stream, int* slot);
+
 VEX_API int vex_token_count(vex_ctx* ctx);
 
 VEX_API vex_arg_token* vex_get_token(vex_ctx* ctx, int num);
 
+VEX_API int vex_pos_count(vex_ctx* ctx);
+
+VEX_API vex_arg_token* vex_get_pos(vex_ctx* ctx, int slot);
+
+VEX_API char** vex_get_passthrough(vex_ctx* ctx, int* count);
+
+VEX_API void vex_get_result(vex_ctx* ctx, vex_result* result);
+
 VEX_API bool vex_arg_found(vex_ctx* ctx, const char* name);
 
+VEX_API bool vex_check_paths(vex_ctx* ctx, int num_threads);
+
+VEX_API const vex_path_result* vex_get_path_results(vex_ctx* ctx, int* count);
+
 VEX_API void vex_free(vex_ctx* ctx);
 
+VEX_API bool vex_get_stats(const vex_ctx* ctx, vex_stats* stats);
+
+VEX_API void vex_reset_stats(vex_ctx* ctx);
+
+VEX_API vex_memory vex_memory_usage(const vex_ctx* ctx);
+
+VEX_API void vex_clear_interned(vex_ctx* ctx);
+
+VEX_API bool vex_usage_init(vex_usage* usage, const vex_ctx* ctx, int num_shards);
+
+VEX_API void vex_usage_attach(vex_ctx* ctx, vex_usage* usage);
+
+VEX_API void vex_usage_snapshot(const vex_usage* usage, uint64_t* counts);
+
+VEX_API bool vex_usage_export(const vex_usage* usage, const vex_ctx* ctx, vex_json_writer* writer);
+
+VEX_API void vex_usage_free(vex_usage* usage);
+
 VEX_API const char* vex_get_version(vex_ctx* ctx);
 
 VEX_API const char* vex_get_help(vex_ctx* ctx);
 
+VEX_API char** vex_build_argv(vex_ctx* ctx, const char* argv0, const vex_arg_token* tokens, int num_tokens, int* argc);
+
+VEX_API char* vex_build_cmdline(vex_ctx* ctx, const char* argv0, const vex_arg_token* tokens, int num_tokens);
+
+VEX_API void vex_free_buffer(void* buffer);
+
+VEX_API bool vex_canonical_hash(vex_ctx* ctx, int argc, char** argv, vex_hash128* hash);
+
+VEX_API bool vex_cache_init(vex_cache* cache, int capacity);
+
+VEX_API const vex_result* vex_cache_parse(vex_cache* cache, vex_ctx* ctx, int argc, char** argv);
+
+VEX_API void vex_cache_clear(vex_cache* cache);
+
+VEX_API void vex_cache_free(vex_cache* cache);
+
+VEX_API size_t vex_result_pack(const vex_result* result, void* buffer, size_t size);
+
+VEX_API const vex_packed_result* vex_packed_open(const void* buffer, size_t size);
+
+VEX_API const vex_packed_token* vex_packed_get_token(const vex_packed_result* packed, int num);
+
+VEX_API const vex_packed_token* vex_packed_get_pos(const vex_packed_result* packed, int slot);
+
+VEX_API const vex_packed_value* vex_packed_get_values(const vex_packed_result* packed, const vex_packed_token* token);
+
+VEX_API const char* vex_packed_get_str(const vex_packed_result* packed, uint32_t offset);
+
+VEX_API const char* vex_packed_get_passthrough(const vex_packed_result* packed, int num);
+
+VEX_API bool vex_packed_arg_found(const vex_packed_result* packed, const char* name);
+
+VEX_API void vex_json_init_buffer(vex_json_writer* writer, char* buffer, size_t capacity);
+
+VEX_API void vex_json_init_fd(vex_json_writer* writer, int fd, char* buffer, size_t capacity);
+
+VEX_API bool vex_json_write(vex_json_writer* writer, const vex_result* result, int flags);
+
+VEX_API bool vex_json_write_batch(vex_json_writer* writer, const vex_result* const* results, int count, int flags);
+
+VEX_API bool vex_json_flush(vex_json_writer* writer);
+
+VEX_API void vex_getopt_init(vex_getopt* state);
+
+VEX_API int vex_getopt_long(vex_getopt* state, int argc, char* const argv[], const char* optstring, const vex_option* longopts, int* longindex);
+
+VEX_API void vex_getopt_free(vex_getopt* state);
+
 #ifdef VEX_IMPLEMENTATION
 
-static char* _vex_strdup(const char* str) {
+#if defined(_WIN32)
+#include <io.h>
+#define _vex_write_fd(fd, buf, len) _write(fd, buf, (unsigned int)(len))
+#else
+#include <unistd.h>
+#define _vex_write_fd(fd, buf, len) write(fd, buf, len)
+#endif
+
+// Path checks
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+typedef struct _stat _vex_stat_info;
+#define _vex_stat(path, info) _stat(path, info)
+#define _vex_readable(path) (_access(path, 4) == 0)
+#define _VEX_IS_DIR(mode) (((mode) & _S_IFMT) == _S_IFDIR)
+#define _VEX_IS_REG(mode) (((mode) & _S_IFMT) == _S_IFREG)
+#else
+typedef struct stat _vex_stat_info;
+#define _vex_stat(path, info) stat(path, info)
+#define _vex_readable(path) (access(path, R_OK) == 0)
+#define _VEX_IS_DIR(mode) S_ISDIR(mode)
+#define _VEX_IS_REG(mode) S_ISREG(mode)
+#endif
+
+// Directory listings for globs
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define _VEX_HAVE_SSE2
+#endif
+
+// Statistics, these compile to nothing unless VEX_ENABLE_STATS is defined
+#ifdef VEX_ENABLE_STATS
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static uint64_t _vex_clock_ns(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER count, freq;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	return (uint64_t)((double)count.QuadPart * 1e9 / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+	// Strict ISO C has no monotonic clock, fall back to processor time
+	return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+#define _VEX_STAT_ADD(ctx, field, n) ((ctx)->stats.field += (n))
+#define _VEX_STAT_PEAK(ctx, field, n) do { if ((n) > (ctx)->stats.field) (ctx)->stats.field = (n); } while (0)
+#define _VEX_STAT_ALLOC(ctx, bytes) do { (ctx)->stats.allocs++; (ctx)->stats.alloc_bytes += (bytes); } while (0)
+#define _VEX_STAT_TIMER(name) uint64_t name = _vex_clock_ns()
+#define _VEX_STAT_TIME(ctx, field, start) ((ctx)->stats.field += _vex_clock_ns() - (start))
+
+// Tokenizing is whatever part of a parse step isn't spent in one of the other phases
+#define _VEX_STAT_PHASES(ctx) ((ctx)->stats.lookup_ns + (ctx)->stats.convert_ns + (ctx)->stats.validate_ns)
+#define _VEX_STAT_STEP_BEGIN(ctx) uint64_t _vex_step_start = _vex_clock_ns(), _vex_step_phases = _VEX_STAT_PHASES(ctx)
+#define _VEX_STAT_STEP_END(ctx) do { \
+		(ctx)->stats.args_scanned++; \
+		(ctx)->stats.tokenize_ns += (_vex_clock_ns() - _vex_step_start) - (_VEX_STAT_PHASES(ctx) - _vex_step_phases); \
+	} while (0)
+#else
+#define _VEX_STAT_ADD(ctx, field, n) ((void)0)
+#define _VEX_STAT_PEAK(ctx, field, n) ((void)0)
+#define _VEX_STAT_ALLOC(ctx, bytes) ((void)0)
+#define _VEX_STAT_TIMER(name)
+#define _VEX_STAT_TIME(ctx, field, start) ((void)0)
+#define _VEX_STAT_STEP_BEGIN(ctx)
+#define _VEX_STAT_STEP_END(ctx) ((void)0)
+#endif
+
+// Every allocation made for a context is counted and traced
+#define _VEX_NOTE_ALLOC(ctx, ptr, bytes) do { _VEX_STAT_ALLOC(ctx, bytes); VEX_TRACE_ALLOC(ctx, ptr, bytes); } while (0)
+
+// Atomic publication of lazily built caches, so concurrent readers see either nothing or the whole value
+#if defined(__GNUC__) || defined(__clang__)
+#define _VEX_HAVE_ATOMICS
+static char* _vex_load_ptr(char** ptr) {
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static bool _vex_publish_ptr(char** ptr, char* value) {
+	char* expected = NULL;
+	return __atomic_compare_exchange_n(ptr, &expected, value, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void _vex_count(uint64_t* counter) {
+	__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+static uint64_t _vex_load_count(const uint64_t* counter) {
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static void _vex_reset_count(uint64_t* counter) {
+	__atomic_store_n(counter, 0, __ATOMIC_RELAXED);
+}
+
+static int _vex_next_int(int* value) {
+	return __atomic_fetch_add(value, 1, __ATOMIC_RELAXED);
+}
+
+static unsigned int _vex_next_uint(unsigned int* value) {
+	return __atomic_fetch_add(value, 1u, __ATOMIC_RELAXED);
+}
+#elif defined(_MSC_VER)
+#define _VEX_HAVE_ATOMICS
+#include <intrin.h>
+static char* _vex_load_ptr(char** ptr) {
+	return (char*)_InterlockedCompareExchangePointer((void* volatile*)ptr, NULL, NULL);
+}
+
+static bool _vex_publish_ptr(char** ptr, char* value) {
+	return _InterlockedCompareExchangePointer((void* volatile*)ptr, value, NULL) == NULL;
+}
+
+static void _vex_count(uint64_t* counter) {
+	_InterlockedExchangeAdd64((volatile __int64*)counter, 1);
+}
+
+static uint64_t _vex_load_count(const uint64_t* counter) {
+	return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)counter, 0, 0);
+}
+
+static void _vex_reset_count(uint64_t* counter) {
+	_InterlockedExchange64((volatile __int64*)counter, 0);
+}
+
+static int _vex_next_int(int* value) {
+	return (int)_InterlockedExchangeAdd((volatile long*)value, 1);
+}
+
+static unsigned int _vex_next_uint(unsigned int* value) {
+	return (unsigned int)_InterlockedExchangeAdd((volatile long*)value, 1);
+}
+#else
+#pragma message("vex: no atomics available, query functions are not thread safe")
+static char* _vex_load_ptr(char** ptr) {
+	return *ptr;
+}
+
+static bool _vex_publish_ptr(char** ptr, char* value) {
+	if (*ptr) return false;
+	*ptr = value;
+	return true;
+}
+
+static void _vex_count(uint64_t* counter) {
+	(*counter)++;
+}
+
+static uint64_t _vex_load_count(const uint64_t* counter) {
+	return *counter;
+}
+
+static void _vex_reset_count(uint64_t* counter) {
+	*counter = 0;
+}
+
+static int _vex_next_int(int* value) {
+	return (*value)++;
+}
+
+static unsigned int _vex_next_uint(unsigned int* value) {
+	return (*value)++;
+}
+#endif
+
+static uint64_t _vex_usage_total(const vex_usage* usage, int d) {
+	uint64_t total = 0;
+	for (int s = 0; s < usage->num_shards; ++s) total += _vex_load_count(&usage->counters[(size_t)s * (size_t)usage->stride + (size_t)d]);
+	return total;
+}
+
+static char* _vex_strdup(vex_ctx* ctx, const char* str) {
 	if (!str) return NULL;
 	size_t len = strlen(str);
 	char* dst = CPPCAST(char*)VEX_MALLOC(len + 1);
 	if (!dst) return NULL;
+	_VEX_NOTE_ALLOC(ctx, dst, len + 1);
+	(void)ctx;
+	memcpy(dst, str, len + 1);
+	return dst;
+}
+
+// Parsed string values are carved out of chunks that are kept between parses
+#define _VEX_ARENA_MIN_CHUNK 1024
+#define _VEX_ARENA_MAX_CHUNK 65536
+
+static char* _vex_arena_strdup(vex_ctx* ctx, const char* str) {
+	size_t len = strlen(str) + 1;
+
+	// Move on to the next chunk (left over from an earlier parse) until one has room
+	vex_arena_chunk* prev = NULL;
+	vex_arena_chunk* chunk = ctx->arena_cur;
+	while (chunk && chunk->size - chunk->used < len) {
+		prev = chunk;
+		chunk = chunk->next;
+		if (chunk) chunk->used = 0;
+	}
+	if (!chunk) {
+		// Grow geometrically so large inputs need few chunks
+		size_t size = (prev && prev->size < _VEX_ARENA_MAX_CHUNK) ? prev->size * 2 : _VEX_ARENA_MIN_CHUNK;
+		if (prev && prev->size >= _VEX_ARENA_MAX_CHUNK) size = _VEX_ARENA_MAX_CHUNK;
+		if (size < len) size = len;
+		chunk = CPPCAST(vex_arena_chunk*)VEX_MALLOC(sizeof(vex_arena_chunk) + size);
+		if (!chunk) return NULL;
+		_VEX_NOTE_ALLOC(ctx, chunk, sizeof(vex_arena_chunk) + size);
+		chunk->next = NULL;
+		chunk->size = size;
+		chunk->used = 0;
+		if (prev) prev->next = chunk;
+		else ctx->arena = chunk;
+	}
+	ctx->arena_cur = chunk;
+	char* dst = (char*)(chunk + 1) + chunk->used;
+	memcpy(dst, str, len);
+	chunk->used += len;
+	return dst;
+}
+
+static size_t _vex_str_size(const char* str) {
+	return str ? strlen(str) + 1 : 0;
+}
+
+static void _vex_token_memory(const vex_arg_token* tokens, int num_tokens, int capacity, vex_memory* usage) {
+	// Tokens past the end of the current results only hold buffers kept for reuse
+	for (int i = 0; i < capacity; ++i) {
+		int used = (i < num_tokens) ? tokens[i].arg_count : 0;
+		usage->values += used * sizeof(vex_value);
+		usage->slack += (tokens[i].arg_capacity - used) * sizeof(vex_value);
+	}
+}
+
+static void _vex_arena_reset(vex_ctx* ctx) {
+	ctx->arena_cur = ctx->arena;
+	if (ctx->arena) ctx->arena->used = 0;
+}
+
+static void _vex_arena_free(vex_ctx* ctx) {
+	while (ctx->arena) {
+		vex_arena_chunk* next = ctx->arena->next;
+		VEX_FREE(ctx->arena);
+		ctx->arena = next;
+	}
+	ctx->arena_cur = NULL;
+}
+
+static uint32_t _vex_name_hash(const char* name, size_t len) {
+	// FNV-1a, short names don't need anything stronger
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static char* _vex_intern_copy(vex_ctx* ctx, const char* str, size_t len) {
+	// Interned text is never released by a parse, so the pool only ever appends to its newest chunk
+	vex_arena_chunk* chunk = ctx->intern_pool;
+	if (!chunk || chunk->size - chunk->used < len + 1) {
+		size_t size = chunk ? chunk->size * 2 : _VEX_ARENA_MIN_CHUNK;
+		if (size > _VEX_ARENA_MAX_CHUNK) size = _VEX_ARENA_MAX_CHUNK;
+		if (size < len + 1) size = len + 1;
+		chunk = CPPCAST(vex_arena_chunk*)VEX_MALLOC(sizeof(vex_arena_chunk) + size);
+		if (!chunk) return NULL;
+		_VEX_NOTE_ALLOC(ctx, chunk, sizeof(vex_arena_chunk) + size);
+		chunk->next = ctx->intern_pool;
+		chunk->size = size;
+		chunk->used = 0;
+		ctx->intern_pool = chunk;
+	}
+	char* dst = (char*)(chunk + 1) + chunk->used;
 	memcpy(dst, str, len + 1);
+	chunk->used += len + 1;
+	return dst;
+}
+
+static char* _vex_intern(vex_ctx* ctx, const char* str) {
+	// Repeated text costs a hash and one compare, and comes back as the pointer handed out the first time
+	size_t len = strlen(str);
+	uint32_t hash = _vex_name_hash(str, len);
+	int mask = ctx->capacity_intern - 1;
+	if (ctx->capacity_intern > 0) {
+		for (int i = (int)(hash & (uint32_t)mask); ctx->intern[i].str; i = (i + 1) & mask) {
+			const vex_intern_entry* entry = &ctx->intern[i];
+			if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0) return entry->str;
+		}
+	}
+
+	// Open addressing kept at most half full, like the option index
+	if ((ctx->num_intern + 1) * 2 > ctx->capacity_intern) {
+		int capacity = (ctx->capacity_intern > 0) ? ctx->capacity_intern * 2 : 64;
+		vex_intern_entry* table = CPPCAST(vex_intern_entry*)VEX_MALLOC(capacity * sizeof(vex_intern_entry));
+		if (!table) return NULL;
+		_VEX_NOTE_ALLOC(ctx, table, capacity * sizeof(vex_intern_entry));
+		memset(table, 0, capacity * sizeof(vex_intern_entry));
+		mask = capacity - 1;
+		for (int e = 0; e < ctx->capacity_intern; ++e) {
+			if (!ctx->intern[e].str) continue;
+			int i = (int)(ctx->intern[e].hash & (uint32_t)mask);
+			while (table[i].str) i = (i + 1) & mask;
+			table[i] = ctx->intern[e];
+		}
+		if (ctx->intern) VEX_FREE(ctx->intern);
+		ctx->intern = table;
+		ctx->capacity_intern = capacity;
+	}
+
+	char* dst = _vex_intern_copy(ctx, str, len);
+	if (!dst) return NULL;
+	int i = (int)(hash & (uint32_t)mask);
+	while (ctx->intern[i].str) i = (i + 1) & mask;
+	ctx->intern[i].str = dst;
+	ctx->intern[i].len = len;
+	ctx->intern[i].hash = hash;
+	ctx->num_intern++;
 	return dst;
 }
 
+static char* _vex_store_str(vex_ctx* ctx, const char* str) {
+	return (ctx->flags & VEX_FLAG_INTERN_STRINGS) ? _vex_intern(ctx, str) : _vex_arena_strdup(ctx, str);
+}
+
+#define _VEX_STATUS_MSG_LEN 256
+
 static void _vex_set_status(vex_ctx* ctx, int status, const char* fmt, ...) {
 	ctx->status = status;
+	ctx->status_offset = 0;
 	if (status != VEX_STATUS_OK && status != VEX_STATUS_BAD_ALLOC && fmt) {
-		if (ctx->status_msg) VEX_FREE(ctx->status_msg);
-		ctx->status_msg = CPPCAST(char*)VEX_MALLOC(256);
+		// The message buffer is reused by later errors
+		if (!ctx->status_msg) {
+			ctx->status_msg = CPPCAST(char*)VEX_MALLOC(_VEX_STATUS_MSG_LEN);
+			if (!ctx->status_msg) return;
+			_VEX_NOTE_ALLOC(ctx, ctx->status_msg, _VEX_STATUS_MSG_LEN);
+		}
 		va_list args;
 		va_start(args, fmt);
-		vsnprintf(ctx->status_msg, 256, fmt, args);
+		vsnprintf(ctx->status_msg, _VEX_STATUS_MSG_LEN, fmt, args);
 		va_end(args);
 	}
 	else {
 		if (ctx->status_msg) VEX_FREE(ctx->status_msg);
 		ctx->status_msg = NULL;
 	}
+	if (status != VEX_STATUS_OK) {
+		VEX_TRACE_ERROR(ctx, status, ctx->status_msg);
+	}
 }
 
-static bool _vex_add_token(vex_ctx* ctx, vex_arg_token token) {
-	// Resize arg token buffer if needed
-	while (ctx->num_arg_token >= ctx->capacity_arg_token) {
-		int new_capacity = ctx->capacity_arg_token * 2;
-		new_capacity += (new_capacity == 0);
-		vex_arg_token* temp = CPPCAST(vex_arg_token*)VEX_REALLOC(ctx->arg_token, new_capacity * sizeof(*temp));
-		if (!temp) {
-			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
-			return false;
+static int _vex_guess_type(const char* arg) {
+	int type = VEX_ARG_TYPE_UNKNOWN;
+	for (const char* c = arg; *c != '\0'; ++c) {
+		if (!isdigit(*c)) {
+			if (*c == '.') {
+				type = VEX_ARG_TYPE_DUB;
+			}
+			else {
+				type = VEX_ARG_TYPE_STR;
+				break;
+			}
+		}
+		else if (type != VEX_ARG_TYPE_DUB) {
+			type = VEX_ARG_TYPE_INT;
 		}
-		memset(&temp[ctx->capacity_arg_token], 0, (new_capacity - ctx->capacity_arg_token) * sizeof(*temp));
-		ctx->arg_token = temp;
-		ctx->capacity_arg_token = new_capacity;
 	}
-
-	// Save to buffer
-	ctx->arg_token[ctx->num_arg_token++] = token;
-	return true;
+	return type;
+}
+
+static size_t _vex_skip_ascii(const unsigned char* s, size_t i, size_t len) {
+	// Whole blocks at a time while no byte has its high bit set, 16 with SSE2 and 8 otherwise
+#ifdef _VEX_HAVE_SSE2
+	while (i + 16 <= len && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(const void*)(s + i))) == 0) i += 16;
+#endif
+	while (i + 8 <= len) {
+		uint64_t word;
+		memcpy(&word, s + i, sizeof(word));
+		if (word & 0x8080808080808080ull) break;
+		i += 8;
+	}
+	while (i < len && s[i] < 0x80) ++i;
+	return i;
+}
+
+static bool _vex_utf8_valid(const char* str, size_t len, size_t* offset) {
+	const unsigned char* s = (const unsigned char*)str;
+	size_t i = 0;
+	for (;;) {
+		i = _vex_skip_ascii(s, i, len);
+		if (i >= len) return true;
+
+		// The range of the second byte rules out overlong forms, surrogates and anything past U+10FFFF
+		unsigned char c = s[i];
+		unsigned char lo = 0x80, hi = 0xBF;
+		size_t n;
+		if (c >= 0xC2 && c <= 0xDF) n = 1;
+		else if (c >= 0xE0 && c <= 0xEF) {
+			n = 2;
+			if (c == 0xE0) lo = 0xA0;
+			if (c == 0xED) hi = 0x9F;
+		}
+		else if (c >= 0xF0 && c <= 0xF4) {
+			n = 3;
+			if (c == 0xF0) lo = 0x90;
+			if (c == 0xF4) hi = 0x8F;
+		}
+		else break;
+		if (len - i <= n || s[i + 1] < lo || s[i + 1] > hi) break;
+		size_t k = 2;
+		while (k <= n && (s[i + k] & 0xC0) == 0x80) ++k;
+		if (k <= n) break;
+		i += n + 1;
+	}
+	*offset = i;
+	return false;
+}
+
+static bool _vex_check_utf8(vex_ctx* ctx, const char* str, const char* name) {
+	// Offset of the first byte of the bad sequence, counted from the start of the value
+	size_t offset = 0;
+	if (_vex_utf8_valid(str, strlen(str), &offset)) return true;
+	_vex_set_status(ctx, VEX_STATUS_BAD_UTF8, "Invalid UTF-8 in %s at byte %lu", name ? name : "argument", (unsigned long)offset);
+	ctx->status_offset = offset;
+	return false;
+}
+
+static bool _vex_convert_value(vex_ctx* ctx, int type, const char* str, const char* name, vex_value* value) {
+	// Strings are copied as-is, numbers must be consumed entirely
+	char* end = NULL;
+	switch (type) {
+	case VEX_ARG_TYPE_INT: {
+		// Where long is as narrow as int, overflow saturates and only shows up in errno
+		errno = 0;
+		long num = strtol(str, &end, 10);
+		if (errno == ERANGE || num < INT_MIN || num > INT_MAX) end = NULL;
+		value->int_arg = (int)num;
+		break;
+	}
+	case VEX_ARG_TYPE_DUB: value->dub_arg = strtod(str, &end); break;
+	case VEX_ARG_TYPE_STR:
+		value->str_arg = _vex_store_str(ctx, str);
+		if (!value->str_arg) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		return true;
+	}
+	if (!end || end == str || *end != '\0') {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Invalid value for %s: %s", name, str);
+		return false;
+	}
+	return true;
+}
+
+static void _vex_truncate_values(vex_arg_token* token, int count) {
+	// String values live in the context arena, so only the count changes
+	token->arg_count = (count < token->arg_count) ? count : token->arg_count;
+}
+
+static void _vex_free_token_values(vex_arg_token* token) {
+	VEX_FREE(token->arg);
+	token->arg = NULL;
+	token->arg_count = 0;
+	token->arg_capacity = 0;
+}
+
+static void _vex_dir_cache_free(vex_ctx* ctx) {
+	for (int i = 0; i < ctx->capacity_dir_cache; ++i) {
+		vex_dir_listing* listing = &ctx->dir_cache[i];
+		if (!listing->path) continue;
+		VEX_FREE(listing->path);
+		if (listing->names) VEX_FREE(listing->names);
+		if (listing->chars) VEX_FREE(listing->chars);
+	}
+	if (ctx->dir_cache) VEX_FREE(ctx->dir_cache);
+	ctx->dir_cache = NULL;
+	ctx->num_dir_cache = 0;
+	ctx->capacity_dir_cache = 0;
+}
+
+static void _vex_clear_tokens(vex_ctx* ctx) {
+	// Empty option tokens, keeping the token array and value buffers for the next parse
+	ctx->num_arg_token = 0;
+
+	// Empty positional slots, keeping the slots themselves
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		_vex_truncate_values(&ctx->pos_token[i], 0);
+	}
+	_vex_arena_reset(ctx);
+
+	// Pass-through arguments are borrowed from argv
+	ctx->pass_argv = NULL;
+	ctx->pass_argc = 0;
+	ctx->pass_after_dash = false;
+	ctx->num_path_results = 0;
+
+	// Directory listings are only trusted for the length of one parse
+	if (ctx->num_dir_cache > 0) _vex_dir_cache_free(ctx);
+
+	// Invalidate checkpoints into the previous results
+	ctx->generation++;
+}
+
+static void _vex_reverse_argv(char** first, char** last) {
+	while (first < last) {
+		last--;
+		char* temp = *first;
+		*first = *last;
+		*last = temp;
+		first++;
+	}
+}
+
+static void _vex_rotate_argv(char** first, char** middle, char** last) {
+	// Move [middle, last) in front of [first, middle) in place, keeping the order of both
+	_vex_reverse_argv(first, middle);
+	_vex_reverse_argv(middle, last);
+	_vex_reverse_argv(first, last);
+}
+
+static void _vex_gather_pass(char** argv, int lo, int hi, const int* index, int num) {
+	// Stable partition of [lo, hi) moving the num arguments at the sorted positions in index to the end, keeping the
+	// order of both sides; halving keeps it O(n log n) with nothing but rotations
+	if (num == 0 || num == hi - lo) return;
+	int mid = lo + (hi - lo) / 2;
+	int left = 0;
+	while (left < num && index[left] < mid) left++;
+	_vex_gather_pass(argv, lo, mid, index, left);
+	_vex_gather_pass(argv, mid, hi, index + left, num - left);
+	_vex_rotate_argv(&argv[mid - left], &argv[mid], &argv[hi - (num - left)]);
+}
+
+typedef struct {
+	char** argv;
+	char* buffer;
+	size_t len;
+	int argc;
+	bool quote;
+} _vex_render_buf;
+
+static bool _vex_shell_safe(unsigned char c) {
+	// Bitmap of [A-Za-z0-9_@%+=:,./-], which never need quoting
+	static const unsigned long long safe[2] = { 0x27fff82000000000ULL, 0x07fffffe87ffffffULL };
+	return c < 128 && ((safe[c >> 6] >> (c & 63)) & 1);
+}
+
+static void _vex_render_arg(_vex_render_buf* out, int num_parts, const char** parts) {
+	// Arguments are rendered from parts so "--name=" and the value need no temporary
+	size_t lens[4] = { 0 };
+	for (int p = 0; p < num_parts; ++p) lens[p] = strlen(parts[p]);
+	if (!out->quote) {
+		char* dst = out->buffer ? &out->buffer[out->len] : NULL;
+		if (dst) out->argv[out->argc] = dst;
+		for (int p = 0; p < num_parts; ++p) {
+			if (dst) memcpy(dst, parts[p], lens[p]);
+			if (dst) dst += lens[p];
+			out->len += lens[p];
+		}
+		if (dst) *dst = '\0';
+		out->len++;
+		out->argc++;
+		return;
+	}
+
+	// Only quote when something in the argument needs it
+	bool needs_quote = true;
+	for (int p = 0; p < num_parts; ++p) {
+		if (lens[p] > 0) needs_quote = false;
+	}
+	for (int p = 0; p < num_parts && !needs_quote; ++p) {
+		for (size_t i = 0; i < lens[p]; ++i) {
+			if (!_vex_shell_safe((unsigned char)parts[p][i])) {
+				needs_quote = true;
+				break;
+			}
+		}
+	}
+	char* dst = out->buffer ? &out->buffer[out->len] : NULL;
+	size_t len = (out->argc > 0) + (needs_quote ? 2 : 0);
+	if (dst && out->argc > 0) *dst++ = ' ';
+	if (dst && needs_quote) *dst++ = '\'';
+	for (int p = 0; p < num_parts; ++p) {
+		for (size_t i = 0; i < lens[p]; ++i) {
+			char c = parts[p][i];
+			if (c == '\'') {
+				// Close the quote, emit an escaped quote, and reopen it
+				len += 4;
+				if (dst) {
+					memcpy(dst, "'\\''", 4);
+					dst += 4;
+				}
+			}
+			else {
+				len++;
+				if (dst) *dst++ = c;
+			}
+		}
+	}
+	if (dst && needs_quote) *dst++ = '\'';
+	out->len += len;
+	out->argc++;
+}
+
+static size_t _vex_format_int(int num, char* buffer) {
+	// Digits are produced backwards, then moved into place
+	char temp[16];
+	size_t len = 0;
+	unsigned int mag = (num < 0) ? 0u - (unsigned int)num : (unsigned int)num;
+	do {
+		temp[len++] = (char)('0' + mag % 10);
+		mag /= 10;
+	} while (mag > 0);
+	size_t pos = 0;
+	if (num < 0) buffer[pos++] = '-';
+	while (len > 0) buffer[pos++] = temp[--len];
+	buffer[pos] = '\0';
+	return pos;
+}
+
+static size_t _vex_format_double(double num, char* buffer, size_t buffer_len) {
+	// Shortest of 15, 16 or 17 significant digits that reads back as the same double; 15 digits always
+	// suffice for values that were typed in, so the later attempts are rare
+	int len = 0;
+	for (int precision = 15; precision <= 17; ++precision) {
+		len = snprintf(buffer, buffer_len, "%.*g", precision, num);
+		if (strtod(buffer, NULL) == num) break;
+	}
+	return (len > 0) ? (size_t)len : 0;
+}
+
+static const char* _vex_format_value(int type, vex_value value, char* buffer, size_t buffer_len) {
+	switch (type) {
+	case VEX_ARG_TYPE_INT: _vex_format_int(value.int_arg, buffer); return buffer;
+	case VEX_ARG_TYPE_DUB: _vex_format_double(value.dub_arg, buffer, buffer_len); return buffer;
+	case VEX_ARG_TYPE_STR: return value.str_arg ? value.str_arg : "";
+	}
+	return "";
+}
+
+static bool _vex_is_pos_token(vex_ctx* ctx, const vex_arg_token* token) {
+	// Slot tokens carry the slot's name; copies from a snapshot or the cache carry their own copy of it, which only
+	// counts when no long-only option has the same name
+	if (token->short_name != '\0') return false;
+	if (!token->long_name) return true;
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		if (token->long_name == ctx->pos_desc[i].name) return true;
+	}
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		if (strcmp(token->long_name, ctx->pos_desc[i].name) != 0) continue;
+		for (int d = 0; d < ctx->num_arg_desc; ++d) {
+			const char* name = ctx->arg_desc[d].long_name;
+			if (name && ctx->arg_desc[d].short_name == '\0' && strcmp(name, token->long_name) == 0) return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+static bool _vex_render_pos(vex_ctx* ctx, _vex_render_buf* out, const vex_arg_token* slots, int num_slots, const vex_arg_token* tokens, int num_tokens) {
+	// Render positional values, or only look for ones that start with a dash when out is NULL
+	char temp[32];
+	for (int pass = 0; pass < 2; ++pass) {
+		const vex_arg_token* list = (pass == 0) ? slots : tokens;
+		int count = (pass == 0) ? num_slots : num_tokens;
+		for (int i = 0; i < count; ++i) {
+			if (pass == 1 && !_vex_is_pos_token(ctx, &list[i])) continue;
+			for (int j = 0; j < list[i].arg_count; ++j) {
+				const char* str = _vex_format_value(list[i].arg_type, list[i].arg[j], temp, sizeof(temp));
+				if (!out && str[0] == '-') return true;
+				if (out) _vex_render_arg(out, 1, &str);
+			}
+		}
+	}
+	return false;
+}
+
+static bool _vex_render(vex_ctx* ctx, const char* argv0, const vex_arg_token* tokens, int num_tokens, _vex_render_buf* out) {
+	// Without a token list, render everything the last parse produced
+	bool whole_ctx = (tokens == NULL);
+	const vex_arg_token* slots = whole_ctx ? ctx->pos_token : NULL;
+	int num_slots = whole_ctx ? ctx->num_pos_desc : 0;
+	if (whole_ctx) {
+		tokens = ctx->arg_token;
+		num_tokens = ctx->num_arg_token;
+	}
+	const char* name = argv0 ? argv0 : ctx->name;
+	_vex_render_arg(out, 1, &name);
+
+	// Positionals go first so they can't be grouped with an option, unless they would be read as options. Those go
+	// after a "--", which would start the pass-through instead when the remainder is forwarded
+	bool late_pos = _vex_render_pos(ctx, NULL, slots, num_slots, tokens, num_tokens);
+	if (late_pos && (ctx->flags & VEX_FLAG_PASS_REMAINDER)) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Positional value starting with '-' can't be rendered when the remainder is passed through");
+		return false;
+	}
+	if (!late_pos) _vex_render_pos(ctx, out, slots, num_slots, tokens, num_tokens);
+
+	// Options, attaching the first value so it's never mistaken for a positional
+	char temp[32];
+	const char* dash = "--";
+	for (int i = 0; i < num_tokens; ++i) {
+		const vex_arg_token* token = &tokens[i];
+		if (_vex_is_pos_token(ctx, token)) continue;
+		char short_name[3] = { '-', token->short_name, '\0' };
+		int j = 0;
+		if (token->long_name && token->arg_count > 0) {
+			const char* parts[4] = { "--", token->long_name, "=", _vex_format_value(token->arg_type, token->arg[0], temp, sizeof(temp)) };
+			_vex_render_arg(out, 4, parts);
+			j++;
+		}
+		else if (token->long_name) {
+			const char* parts[2] = { "--", token->long_name };
+			_vex_render_arg(out, 2, parts);
+		}
+		else {
+			const char* parts[1] = { short_name };
+			_vex_render_arg(out, 1, parts);
+		}
+		for (; j < token->arg_count; ++j) {
+			const char* str = _vex_format_value(token->arg_type, token->arg[j], temp, sizeof(temp));
+			_vex_render_arg(out, 1, &str);
+		}
+	}
+
+	// Forwarded arguments are copied verbatim; the remainder brings its own "--", and forwarded options must come
+	// before a late one
+	if (whole_ctx && ctx->pass_argc > 0) {
+		if (ctx->pass_after_dash) _vex_render_arg(out, 1, &dash);
+		for (int i = 0; i < ctx->pass_argc; ++i) {
+			const char* str = ctx->pass_argv[i];
+			_vex_render_arg(out, 1, &str);
+		}
+	}
+	if (late_pos) {
+		_vex_render_arg(out, 1, &dash);
+		_vex_render_pos(ctx, out, slots, num_slots, tokens, num_tokens);
+	}
+	return true;
+}
+
+static bool _vex_add_token(vex_ctx* ctx, vex_arg_token token) {
+	// Resize arg token buffer if needed
+	while (ctx->num_arg_token >= ctx->capacity_arg_token) {
+		int new_capacity = ctx->capacity_arg_token * 2;
+		new_capacity += (new_capacity == 0);
+		vex_arg_token* temp = CPPCAST(vex_arg_token*)VEX_REALLOC(ctx->arg_token, new_capacity * sizeof(*temp));
+		if (!temp) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, temp, new_capacity * sizeof(*temp));
+		memset(&temp[ctx->capacity_arg_token], 0, (new_capacity - ctx->capacity_arg_token) * sizeof(*temp));
+		ctx->arg_token = temp;
+		ctx->capacity_arg_token = new_capacity;
+	}
+
+	// Save to buffer, reusing any value buffer left in the slot by an earlier parse
+	vex_arg_token* slot = &ctx->arg_token[ctx->num_arg_token++];
+	token.arg = slot->arg;
+	token.arg_count = 0;
+	token.arg_capacity = slot->arg_capacity;
+	*slot = token;
+	_VEX_STAT_PEAK(ctx, peak_tokens, ctx->num_arg_token);
+	return true;
 }
 
 static bool _vec_token_add_value(vex_ctx* ctx, vex_arg_token* token, vex_value value) {
-	// Resize token value buffer
-	vex_value* temp = CPPCAST(vex_value*)VEX_REALLOC(token->arg, (token->arg_count + 1) * sizeof(*token->arg));
-	if (!temp) {
+	// Resize token value buffer if needed
+	if (token->arg_count >= token->arg_capacity) {
+		int new_capacity = token->arg_capacity * 2;
+		new_capacity += (new_capacity == 0);
+		vex_value* temp = CPPCAST(vex_value*)VEX_REALLOC(token->arg, new_capacity * sizeof(*temp));
+		if (!temp) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, temp, new_capacity * sizeof(*temp));
+		token->arg = temp;
+		token->arg_capacity = new_capacity;
+	}
+	token->arg[token->arg_count++] = value;
+	_VEX_STAT_PEAK(ctx, peak_values, token->arg_count);
+	return true;
+}
+
+static uint64_t _vex_rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t _vex_fmix64(uint64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+static void _vex_hash_mix(vex_hash128* hash, uint64_t k) {
+	// Two murmur3-style lanes, each folding in the other so neither can cancel out
+	hash->lo ^= _vex_rotl64(k * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+	hash->lo = _vex_rotl64(hash->lo, 27) + hash->hi;
+	hash->lo = hash->lo * 5 + 0x52dce729;
+	hash->hi ^= _vex_rotl64(k * 0x4cf5ad432745937fULL, 33) * 0x87c37b91114253d5ULL;
+	hash->hi = _vex_rotl64(hash->hi, 31) + hash->lo;
+	hash->hi = hash->hi * 5 + 0x38495ab5;
+}
+
+static void _vex_hash_bytes(vex_hash128* hash, const char* data, size_t len) {
+	// Words are assembled little-endian so hashes are stable across platforms
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		uint64_t k = 0;
+		for (int b = 7; b >= 0; --b) k = (k << 8) | (unsigned char)data[i + b];
+		_vex_hash_mix(hash, k);
+	}
+	uint64_t k = 0;
+	for (size_t b = len; b > i; --b) k = (k << 8) | (unsigned char)data[b - 1];
+	_vex_hash_mix(hash, k ^ ((uint64_t)len << 56));
+}
+
+static void _vex_hash_tag(vex_hash128* hash, char tag, int num) {
+	_vex_hash_mix(hash, ((uint64_t)(unsigned char)tag << 32) | (uint32_t)num);
+}
+
+static void _vex_hash_final(vex_hash128* hash) {
+	hash->lo += hash->hi;
+	hash->hi += hash->lo;
+	hash->lo = _vex_fmix64(hash->lo);
+	hash->hi = _vex_fmix64(hash->hi);
+	hash->lo += hash->hi;
+	hash->hi += hash->lo;
+}
+
+static size_t _vex_align(size_t size) {
+	return (size + 7) & ~(size_t)7;
+}
+
+static char* _vex_snapshot_str(char** chars, const char* str) {
+	if (!str) return NULL;
+	size_t len = strlen(str) + 1;
+	char* dst = *chars;
+	memcpy(dst, str, len);
+	*chars += len;
+	return dst;
+}
+
+static size_t _vex_snapshot_size(const vex_arg_token* tokens, int num_tokens, size_t* num_values) {
+	size_t num_chars = 0;
+	for (int i = 0; i < num_tokens; ++i) {
+		*num_values += tokens[i].arg_count;
+		if (tokens[i].long_name) num_chars += strlen(tokens[i].long_name) + 1;
+		if (tokens[i].arg_type != VEX_ARG_TYPE_STR) continue;
+		for (int j = 0; j < tokens[i].arg_count; ++j) num_chars += strlen(tokens[i].arg[j].str_arg) + 1;
+	}
+	return num_chars;
+}
+
+static void _vex_snapshot_tokens(const vex_arg_token* src, int num_tokens, vex_arg_token* dst, vex_value** values, char** chars) {
+	for (int i = 0; i < num_tokens; ++i) {
+		dst[i] = src[i];
+		dst[i].long_name = _vex_snapshot_str(chars, src[i].long_name);
+		dst[i].arg = *values;
+		dst[i].arg_capacity = src[i].arg_count;
+		for (int j = 0; j < src[i].arg_count; ++j) {
+			dst[i].arg[j] = src[i].arg[j];
+			if (src[i].arg_type == VEX_ARG_TYPE_STR) dst[i].arg[j].str_arg = _vex_snapshot_str(chars, src[i].arg[j].str_arg);
+		}
+		*values += src[i].arg_count;
+	}
+}
+
+static vex_result* _vex_snapshot(vex_ctx* ctx) {
+	// Sizing pass
+	size_t num_values = 0;
+	size_t num_chars = _vex_snapshot_size(ctx->arg_token, ctx->num_arg_token, &num_values);
+	num_chars += _vex_snapshot_size(ctx->pos_token, ctx->num_pos_desc, &num_values);
+	for (int i = 0; i < ctx->pass_argc; ++i) num_chars += strlen(ctx->pass_argv[i]) + 1;
+
+	// Everything lives in one block, so the copy is released with a single free
+	size_t len_header = _vex_align(sizeof(vex_result));
+	size_t len_values = _vex_align(num_values * sizeof(vex_value));
+	size_t len_tokens = _vex_align((ctx->num_arg_token + ctx->num_pos_desc) * sizeof(vex_arg_token));
+	size_t len_pass = _vex_align((ctx->pass_argc + 1) * sizeof(char*));
+	char* block = CPPCAST(char*)VEX_MALLOC(len_header + len_values + len_tokens + len_pass + num_chars);
+	if (!block) return NULL;
+	vex_result* result = CPPCAST(vex_result*)(void*)block;
+	vex_value* values = CPPCAST(vex_value*)(void*)(block + len_header);
+	vex_arg_token* tokens = CPPCAST(vex_arg_token*)(void*)(block + len_header + len_values);
+	char** pass = CPPCAST(char**)(void*)(block + len_header + len_values + len_tokens);
+	char* chars = block + len_header + len_values + len_tokens + len_pass;
+
+	result->arg_token = tokens;
+	result->num_arg_token = ctx->num_arg_token;
+	result->pos_token = tokens + ctx->num_arg_token;
+	result->num_pos_token = ctx->num_pos_desc;
+	result->pass_argv = pass;
+	result->pass_argc = ctx->pass_argc;
+	_vex_snapshot_tokens(ctx->arg_token, ctx->num_arg_token, result->arg_token, &values, &chars);
+	_vex_snapshot_tokens(ctx->pos_token, ctx->num_pos_desc, result->pos_token, &values, &chars);
+	for (int i = 0; i < ctx->pass_argc; ++i) pass[i] = _vex_snapshot_str(&chars, ctx->pass_argv[i]);
+	pass[ctx->pass_argc] = NULL;
+	return result;
+}
+
+static uint32_t _vex_pack_str(char* base, size_t* offset, const char* str) {
+	if (!str) return 0;
+	size_t len = strlen(str) + 1;
+	uint32_t dst = (uint32_t)*offset;
+	memcpy(&base[dst], str, len);
+	*offset += len;
+	return dst;
+}
+
+static void _vex_pack_tokens(char* base, const vex_arg_token* src, int num_tokens, vex_packed_token* dst, size_t* values, size_t* chars) {
+	for (int i = 0; i < num_tokens; ++i) {
+		dst[i].long_name = _vex_pack_str(base, chars, src[i].long_name);
+		dst[i].arg = (uint32_t)*values;
+		dst[i].arg_count = src[i].arg_count;
+		dst[i].arg_type = src[i].arg_type;
+		dst[i].short_name = src[i].short_name;
+		vex_packed_value* value = CPPCAST(vex_packed_value*)(void*)&base[*values];
+		for (int j = 0; j < src[i].arg_count; ++j) {
+			switch (src[i].arg_type) {
+			case VEX_ARG_TYPE_INT: value[j].int_arg = src[i].arg[j].int_arg; break;
+			case VEX_ARG_TYPE_DUB: value[j].dub_arg = src[i].arg[j].dub_arg; break;
+			case VEX_ARG_TYPE_STR: value[j].str_arg = _vex_pack_str(base, chars, src[i].arg[j].str_arg); break;
+			}
+		}
+		*values += src[i].arg_count * sizeof(vex_packed_value);
+	}
+}
+
+static bool _vex_packed_range(const vex_packed_result* packed, uint64_t offset, uint64_t len) {
+	return offset + len <= packed->size;
+}
+
+static void _vex_json_put(vex_json_writer* writer, const char* data, size_t len) {
+	writer->total += len;
+	if (writer->error) return;
+	if (writer->len + len > writer->capacity) {
+		if (writer->fd < 0) {
+			// Keep counting so the caller learns how much space was needed
+			writer->overflow = true;
+			writer->error = true;
+			return;
+		}
+		if (!vex_json_flush(writer)) return;
+		if (len > writer->capacity) {
+			// Too large to stage, write straight through
+			while (len > 0) {
+				long written = (long)_vex_write_fd(writer->fd, data, len);
+				if (written <= 0) {
+					writer->error = true;
+					return;
+				}
+				data += written;
+				len -= (size_t)written;
+			}
+			return;
+		}
+	}
+	memcpy(&writer->buffer[writer->len], data, len);
+	writer->len += len;
+}
+
+static void _vex_json_str(vex_json_writer* writer, const char* str) {
+	if (!str) {
+		_vex_json_put(writer, "null", 4);
+		return;
+	}
+
+	// Copy runs of characters that need no escaping in one go; bytes that aren't valid UTF-8 become U+FFFD
+	_vex_json_put(writer, "\"", 1);
+	const char* end = str + strlen(str);
+	size_t offset = 0;
+	const char* bad = _vex_utf8_valid(str, (size_t)(end - str), &offset) ? NULL : str + offset;
+	const char* run = str;
+	for (const char* c = str; ; ++c) {
+		unsigned char ch = (unsigned char)*c;
+		if (ch >= 0x20 && ch != '"' && ch != '\\' && c != bad) continue;
+		_vex_json_put(writer, run, (size_t)(c - run));
+		if (c == bad) {
+			// Resume checking after the bad byte, so the whole string is still scanned once
+			_vex_json_put(writer, "\\ufffd", 6);
+			bad = _vex_utf8_valid(c + 1, (size_t)(end - c - 1), &offset) ? NULL : c + 1 + offset;
+			run = c + 1;
+			continue;
+		}
+		if (ch == '\0') break;
+		char escape[8] = { '\\', (char)ch, 0 };
+		size_t escape_len = 2;
+		switch (ch) {
+		case '\n': escape[1] = 'n'; break;
+		case '\r': escape[1] = 'r'; break;
+		case '\t': escape[1] = 't'; break;
+		case '\b': escape[1] = 'b'; break;
+		case '\f': escape[1] = 'f'; break;
+		case '"': case '\\': break;
+		default:
+			snprintf(escape, sizeof(escape), "\\u%04x", ch);
+			escape_len = 6;
+			break;
+		}
+		_vex_json_put(writer, escape, escape_len);
+		run = c + 1;
+	}
+	_vex_json_put(writer, "\"", 1);
+}
+
+static void _vex_json_values(vex_json_writer* writer, const vex_arg_token* token) {
+	static const char* type_names[] = { "unknown", "flag", "int", "double", "string" };
+	char temp[32];
+	int type = (token->arg_type >= 0 && token->arg_type <= VEX_ARG_TYPE_STR) ? token->arg_type : VEX_ARG_TYPE_UNKNOWN;
+	_vex_json_put(writer, ",\"type\":\"", 9);
+	_vex_json_put(writer, type_names[type], strlen(type_names[type]));
+	_vex_json_put(writer, "\",\"values\":[", 12);
+	for (int j = 0; j < token->arg_count; ++j) {
+		if (j > 0) _vex_json_put(writer, ",", 1);
+		switch (type) {
+		case VEX_ARG_TYPE_INT:
+			_vex_json_put(writer, temp, _vex_format_int(token->arg[j].int_arg, temp));
+			break;
+		case VEX_ARG_TYPE_DUB:
+			// JSON has no representation for infinities or NaN
+			if (token->arg[j].dub_arg - token->arg[j].dub_arg != 0.0) _vex_json_put(writer, "null", 4);
+			else _vex_json_put(writer, temp, _vex_format_double(token->arg[j].dub_arg, temp, sizeof(temp)));
+			break;
+		case VEX_ARG_TYPE_STR:
+			_vex_json_str(writer, token->arg[j].str_arg);
+			break;
+		default:
+			_vex_json_put(writer, "null", 4);
+			break;
+		}
+	}
+	_vex_json_put(writer, "]}", 2);
+}
+
+static void _vex_json_result(vex_json_writer* writer, const vex_result* result) {
+	_vex_json_put(writer, "{\"tokens\":[", 11);
+	for (int i = 0; i < result->num_arg_token; ++i) {
+		const vex_arg_token* token = &result->arg_token[i];
+		_vex_json_put(writer, (i > 0) ? ",{" : "{", (i > 0) ? 2 : 1);
+		char short_name[2] = { token->short_name, '\0' };
+		_vex_json_put(writer, "\"short\":", 8);
+		_vex_json_str(writer, token->short_name ? short_name : NULL);
+		_vex_json_put(writer, ",\"long\":", 8);
+		_vex_json_str(writer, token->long_name);
+		_vex_json_values(writer, token);
+	}
+	_vex_json_put(writer, "],\"positionals\":[", 17);
+	for (int i = 0; i < result->num_pos_token; ++i) {
+		const vex_arg_token* token = &result->pos_token[i];
+		_vex_json_put(writer, (i > 0) ? ",{\"name\":" : "{\"name\":", (i > 0) ? 9 : 8);
+		_vex_json_str(writer, token->long_name);
+		_vex_json_values(writer, token);
+	}
+	_vex_json_put(writer, "],\"passthrough\":[", 17);
+	for (int i = 0; i < result->pass_argc; ++i) {
+		if (i > 0) _vex_json_put(writer, ",", 1);
+		_vex_json_str(writer, result->pass_argv[i]);
+	}
+	_vex_json_put(writer, "]}", 2);
+}
+
+static int _vex_cache_find(vex_cache* cache, vex_hash128 hash) {
+	int e = cache->buckets[hash.lo & (cache->num_buckets - 1)];
+	while (e >= 0) {
+		vex_cache_entry* entry = &cache->entries[e];
+		if (entry->hash.lo == hash.lo && entry->hash.hi == hash.hi) return e;
+		e = entry->chain;
+	}
+	return -1;
+}
+
+static void _vex_cache_unlink(vex_cache* cache, int e) {
+	vex_cache_entry* entry = &cache->entries[e];
+	if (entry->prev >= 0) cache->entries[entry->prev].next = entry->next;
+	else cache->head = entry->next;
+	if (entry->next >= 0) cache->entries[entry->next].prev = entry->prev;
+	else cache->tail = entry->prev;
+	entry->prev = -1;
+	entry->next = -1;
+}
+
+static void _vex_cache_push_front(vex_cache* cache, int e) {
+	vex_cache_entry* entry = &cache->entries[e];
+	entry->prev = -1;
+	entry->next = cache->head;
+	if (cache->head >= 0) cache->entries[cache->head].prev = e;
+	cache->head = e;
+	if (cache->tail < 0) cache->tail = e;
+}
+
+static int _vex_cache_evict(vex_cache* cache) {
+	// Drop the least recently used entry from both the LRU list and its bucket
+	int e = cache->tail;
+	vex_cache_entry* entry = &cache->entries[e];
+	_vex_cache_unlink(cache, e);
+	int* link = &cache->buckets[entry->hash.lo & (cache->num_buckets - 1)];
+	while (*link != e) link = &cache->entries[*link].chain;
+	*link = entry->chain;
+	VEX_FREE(entry->result);
+	entry->result = NULL;
+	return e;
+}
+
+// Hot record flags kept alongside the descriptor flags, for options in a group and slots left by a removed group
+#define _VEX_HOT_GROUPED 0x4000
+#define _VEX_HOT_REMOVED 0x8000
+
+static void _vex_index_put(int* index, int capacity, uint32_t hash, int d) {
+	int mask = capacity - 1;
+	int i = (int)(hash & (uint32_t)mask);
+	while (index[i] >= 0) i = (i + 1) & mask;
+	index[i] = d;
+}
+
+static bool _vex_index_add(vex_ctx* ctx, int d) {
+	// Open addressing kept at most half full, rebuilt at twice the size when it fills up; grouped options have their own
+	if (ctx->arg_hot[d].name_len == 0) return true;
+	if ((d + 1) * 2 > ctx->capacity_arg_index) {
+		int capacity = (ctx->capacity_arg_index > 0) ? ctx->capacity_arg_index * 2 : 16;
+		int* index = CPPCAST(int*)VEX_MALLOC(capacity * sizeof(int));
+		if (!index) return false;
+		_VEX_NOTE_ALLOC(ctx, index, capacity * sizeof(int));
+		memset(index, 0xff, capacity * sizeof(int));
+		for (int e = 0; e < d; ++e) {
+			if (ctx->arg_hot[e].name_len > 0 && !(ctx->arg_hot[e].flags & _VEX_HOT_GROUPED)) _vex_index_put(index, capacity, ctx->arg_hot[e].name_hash, e);
+		}
+		if (ctx->arg_index) VEX_FREE(ctx->arg_index);
+		ctx->arg_index = index;
+		ctx->capacity_arg_index = capacity;
+	}
+	_vex_index_put(ctx->arg_index, ctx->capacity_arg_index, ctx->arg_hot[d].name_hash, d);
+	return true;
+}
+
+static int _vex_find_short(vex_ctx* ctx, char c) {
+	_VEX_STAT_ADD(ctx, lookup_probes, 1);
+	unsigned char u = (unsigned char)c;
+	return (u < 128) ? ctx->short_index[u] - 1 : -1;
+}
+
+static int _vex_find_group(const vex_ctx* ctx, const char* prefix, size_t len, uint32_t hash) {
+	if (ctx->capacity_group_index == 0) return -1;
+	int mask = ctx->capacity_group_index - 1;
+	for (int i = (int)(hash & (uint32_t)mask); ctx->group_index[i] >= 0; i = (i + 1) & mask) {
+		const vex_group* group = &ctx->groups[ctx->group_index[i]];
+		if (group->prefix_hash == hash && group->prefix_len == len && memcmp(group->prefix, prefix, len) == 0) return ctx->group_index[i];
+	}
+	return -1;
+}
+
+static int _vex_find_grouped(vex_ctx* ctx, const char* name, size_t len, uint32_t hash) {
+	// The namespace is everything before the last dot, and only its own index is searched for the full name
+	size_t split = len;
+	while (split > 0 && name[split - 1] != '.') --split;
+	if (split < 2) return -1;
+	int g = _vex_find_group(ctx, name, split - 1, _vex_name_hash(name, split - 1));
+	if (g < 0) return -1;
+	const vex_group* group = &ctx->groups[g];
+	int mask = group->capacity_index - 1;
+	for (int i = (int)(hash & (uint32_t)mask); group->index[i] >= 0; i = (i + 1) & mask) {
+		int d = group->index[i];
+		_VEX_STAT_ADD(ctx, lookup_probes, 1);
+		const vex_arg_hot* hot = &ctx->arg_hot[d];
+		if (hot->name_hash == hash && hot->name_len == len && memcmp(ctx->arg_desc[d].long_name, name, len) == 0) return d;
+	}
+	return -1;
+}
+
+static int _vex_find_long(vex_ctx* ctx, const char* name, size_t len) {
+	// Dotted names may belong to a group
+	if (ctx->capacity_group_index > 0) {
+		int d = _vex_find_grouped(ctx, name, len, _vex_name_hash(name, len));
+		if (d >= 0) return d;
+	}
+
+	// Exact names through the hash index, checking the cold name only when the hot hash and length agree
+	if (ctx->capacity_arg_index > 0) {
+		uint32_t hash = _vex_name_hash(name, len);
+		int mask = ctx->capacity_arg_index - 1;
+		for (int i = (int)(hash & (uint32_t)mask); ctx->arg_index[i] >= 0; i = (i + 1) & mask) {
+			int d = ctx->arg_index[i];
+			_VEX_STAT_ADD(ctx, lookup_probes, 1);
+			const vex_arg_hot* hot = &ctx->arg_hot[d];
+			if (hot->name_hash == hash && hot->name_len == len && memcmp(ctx->arg_desc[d].long_name, name, len) == 0) return d;
+		}
+	}
+
+	// Otherwise the first option starting with the given name; abbreviations aren't checked for ambiguity, the earliest match wins
+	for (int d = 0; d < ctx->num_arg_desc; ++d) {
+		_VEX_STAT_ADD(ctx, lookup_probes, 1);
+		if (ctx->arg_hot[d].name_len > len && strncmp(name, ctx->arg_desc[d].long_name, len) == 0) return d;
+	}
+	return -1;
+}
+
+static bool _vex_add_converted(vex_ctx* ctx, vex_arg_token* token, int type, const char* str) {
+	_VEX_STAT_TIMER(start);
+	vex_value value = { 0 };
+	switch (type) {
+	case VEX_ARG_TYPE_INT: value.int_arg = atoi(str); break;
+	case VEX_ARG_TYPE_DUB: value.dub_arg = atof(str); break;
+	case VEX_ARG_TYPE_STR:
+		value.str_arg = _vex_store_str(ctx, str);
+		if (!value.str_arg) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		break;
+	}
+	_VEX_STAT_TIME(ctx, convert_ns, start);
+	VEX_TRACE_VALUE_CONVERTED(ctx, type, str);
+	return _vec_token_add_value(ctx, token, value);
+}
+
+static bool _vex_add_option(vex_ctx* ctx, _vex_parse_state* st, int d) {
+	VEX_TRACE_OPTION_RESOLVED(ctx, ctx->arg_desc[d].long_name, ctx->arg_desc[d].short_name);
+	st->last_desc = d;
+	st->last_count = 0;
+	if (st->hash) {
+		_vex_hash_tag(st->hash, 'O', d);
+		return true;
+	}
+	if (ctx->usage_shard && d < ctx->usage->num_counters) _vex_count(&ctx->usage_shard[d]);
+	vex_arg_token token = { 0 };
+	token.short_name = ctx->arg_hot[d].short_name;
+	token.long_name = ctx->arg_desc[d].long_name;
+	token.arg_type = ctx->arg_hot[d].arg_type;
+	if (!_vex_add_token(ctx, token)) return false;
+	st->last_token = ctx->num_arg_token - 1;
+	return true;
+}
+
+static bool _vex_check_values(vex_ctx* ctx, int count, const char* name) {
+	if (ctx->limits.max_values > 0 && count > ctx->limits.max_values) {
+		_vex_set_status(ctx, VEX_STATUS_LIMIT_EXCEEDED, "Too many values for %s", name ? name : "argument");
+		return false;
+	}
+	return true;
+}
+
+static bool _vex_check_input(vex_ctx* ctx, _vex_parse_state* st, int num_args, size_t num_bytes) {
+	// Counted before anything is stored, so oversized input is rejected without being copied
+	st->num_args += num_args;
+	st->total_bytes += num_bytes;
+	if (ctx->limits.max_args > 0 && st->num_args > ctx->limits.max_args) {
+		_vex_set_status(ctx, VEX_STATUS_LIMIT_EXCEEDED, "Too many arguments (limit %d)", ctx->limits.max_args);
+		return false;
+	}
+	if (ctx->limits.max_total_bytes > 0 && st->total_bytes > ctx->limits.max_total_bytes) {
+		_vex_set_status(ctx, VEX_STATUS_LIMIT_EXCEEDED, "Input too large (limit %lu bytes)", (unsigned long)ctx->limits.max_total_bytes);
+		return false;
+	}
+	return true;
+}
+
+#define _VEX_PATH_CHECKS (VEX_DESC_PATH_EXISTS | VEX_DESC_PATH_FILE | VEX_DESC_PATH_DIR | VEX_DESC_PATH_READABLE)
+
+static bool _vex_note_path(vex_ctx* ctx, int checks, const vex_arg_token* token, bool positional, int num) {
+	// Paths are only collected while parsing, vex_check_paths looks at them all at once afterwards
+	if (ctx->num_path_results >= ctx->capacity_path_results) {
+		int capacity = (ctx->capacity_path_results > 0) ? ctx->capacity_path_results * 2 : 16;
+		vex_path_result* results = CPPCAST(vex_path_result*)VEX_REALLOC(ctx->path_results, capacity * sizeof(vex_path_result));
+		if (!results) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, results, capacity * sizeof(vex_path_result));
+		ctx->path_results = results;
+		ctx->capacity_path_results = capacity;
+	}
+	vex_path_result* result = &ctx->path_results[ctx->num_path_results++];
+	result->path = token->arg[token->arg_count - 1].str_arg;
+	result->token = num;
+	result->value = token->arg_count - 1;
+	result->positional = positional;
+	result->checks = checks & _VEX_PATH_CHECKS;
+	result->kind = VEX_PATH_MISSING;
+	result->error = 0;
+	return true;
+}
+
+#define _VEX_GLOB_LITERAL 0
+#define _VEX_GLOB_ANY 1
+#define _VEX_GLOB_STAR 2
+#define _VEX_GLOB_CLASS 3
+#define _VEX_GLOB_MAX_PATH 4096
+#define _VEX_GLOB_MAX_DEPTH 64
+
+typedef struct {
+	unsigned char op;
+	unsigned char c;
+	unsigned char set[32];
+} _vex_glob_op;
+
+typedef struct {
+	int first;
+	int num_ops;
+	bool literal;
+} _vex_glob_part;
+
+typedef struct {
+	vex_ctx* ctx;
+	vex_arg_token* token;
+	const char* name;
+	int flags;
+	bool positional;
+	int num;
+	_vex_glob_op* ops;
+	_vex_glob_part* parts;
+	int num_parts;
+	int matches;
+	bool dir_only;
+	char path[_VEX_GLOB_MAX_PATH];
+} _vex_glob;
+
+static bool _vex_has_glob(const char* str) {
+	for (; *str; ++str) {
+		if (*str == '*' || *str == '?' || *str == '[') return true;
+		if (*str == '\\' && str[1]) ++str;
+	}
+	return false;
+}
+
+static const char* _vex_glob_class(const char* p, _vex_glob_op* op) {
+	// [abc], [a-z], [!x] or [^x]; a ']' right after the opening bracket is a member; no closing bracket makes '[' literal
+	const char* c = p + 1;
+	bool negate = (*c == '!' || *c == '^');
+	if (negate) ++c;
+	memset(op->set, 0, sizeof(op->set));
+	const char* first = c;
+	for (; *c && *c != '/' && (*c != ']' || c == first); ++c) {
+		unsigned char lo = (unsigned char)*c, hi = lo;
+		if (c[1] == '-' && c[2] && c[2] != ']' && c[2] != '/') {
+			hi = (unsigned char)c[2];
+			c += 2;
+		}
+		for (unsigned v = lo; v <= hi; ++v) op->set[v >> 3] |= (unsigned char)(1u << (v & 7));
+	}
+	if (*c != ']') {
+		op->op = _VEX_GLOB_LITERAL;
+		op->c = '[';
+		return p + 1;
+	}
+	if (negate) {
+		for (int i = 0; i < 32; ++i) op->set[i] = (unsigned char)~op->set[i];
+	}
+	op->op = _VEX_GLOB_CLASS;
+	return c + 1;
+}
+
+static int _vex_glob_compile(const char* pattern, _vex_glob_op* ops, _vex_glob_part* parts) {
+	// One part per path component, each a run of single character operations
+	int num_parts = 0, num_ops = 0;
+	const char* p = pattern;
+	while (*p) {
+		if (*p == '/') {
+			++p;
+			continue;
+		}
+		_vex_glob_part* part = &parts[num_parts++];
+		part->first = num_ops;
+		part->literal = true;
+		while (*p && *p != '/') {
+			_vex_glob_op* op = &ops[num_ops];
+			if (*p == '*') {
+				while (*p == '*') ++p;
+				op->op = _VEX_GLOB_STAR;
+				part->literal = false;
+			}
+			else if (*p == '?') {
+				op->op = _VEX_GLOB_ANY;
+				part->literal = false;
+				++p;
+			}
+			else if (*p == '[') {
+				p = _vex_glob_class(p, op);
+				if (op->op == _VEX_GLOB_CLASS) part->literal = false;
+			}
+			else {
+				if (*p == '\\' && p[1] && p[1] != '/') ++p;
+				op->op = _VEX_GLOB_LITERAL;
+				op->c = (unsigned char)*p++;
+			}
+			num_ops++;
+		}
+		part->num_ops = num_ops - part->first;
+	}
+	return num_parts;
+}
+
+static void _vex_glob_unescape(char* dst, const char* src) {
+	// Same rule as compiling: a backslash before anything but a separator stands for the next character
+	while (*src) {
+		if (*src == '\\' && src[1] && src[1] != '/') ++src;
+		*dst++ = *src++;
+	}
+	*dst = '\0';
+}
+
+static bool _vex_glob_step(const _vex_glob_op* op, unsigned char c) {
+	switch (op->op) {
+	case _VEX_GLOB_LITERAL: return op->c == c;
+	case _VEX_GLOB_ANY: return true;
+	case _VEX_GLOB_CLASS: return (op->set[c >> 3] >> (c & 7)) & 1;
+	}
+	return false;
+}
+
+static bool _vex_glob_match(const _vex_glob_op* ops, int num_ops, const char* name) {
+	// Hidden entries only match a pattern that starts with a literal dot
+	if (name[0] == '.' && (num_ops == 0 || ops[0].op != _VEX_GLOB_LITERAL || ops[0].c != '.')) return false;
+
+	// Backtracking only to the most recent star keeps this linear in practice
+	int o = 0, star = -1;
+	const char* s = name;
+	const char* star_s = NULL;
+	while (*s) {
+		if (o < num_ops && ops[o].op == _VEX_GLOB_STAR) {
+			star = ++o;
+			star_s = s;
+		}
+		else if (o < num_ops && _vex_glob_step(&ops[o], (unsigned char)*s)) {
+			++o;
+			++s;
+		}
+		else if (star >= 0) {
+			o = star;
+			s = ++star_s;
+		}
+		else return false;
+	}
+	while (o < num_ops && ops[o].op == _VEX_GLOB_STAR) ++o;
+	return o == num_ops;
+}
+
+static int _vex_compare_names(const void* a, const void* b) {
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static bool _vex_read_dir(vex_ctx* ctx, const char* path, vex_dir_listing* listing) {
+	// Names are packed into one buffer; a path that isn't a readable directory lists as empty
+	size_t used = 0, capacity = 0;
+	char* chars = NULL;
+	int count = 0;
+	bool ok = true;
+	(void)ctx;
+#if defined(_WIN32)
+	char search[_VEX_GLOB_MAX_PATH + 3];
+	snprintf(search, sizeof(search), "%s\\*", path);
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA(search, &data);
+	bool more = find != INVALID_HANDLE_VALUE;
+	while (ok && more) {
+		const char* name = data.cFileName;
+#else
+	DIR* dir = opendir(path);
+	struct dirent* entry;
+	while (ok && dir && (entry = readdir(dir)) != NULL) {
+		const char* name = entry->d_name;
+#endif
+		if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0) {
+			size_t len = strlen(name) + 1;
+			if (used + len > capacity) {
+				capacity = (capacity > 0) ? capacity * 2 : 1024;
+				if (capacity < used + len) capacity = used + len;
+				char* temp = CPPCAST(char*)VEX_REALLOC(chars, capacity);
+				if (temp) {
+					_VEX_NOTE_ALLOC(ctx, temp, capacity);
+					chars = temp;
+				}
+				else ok = false;
+			}
+			if (ok) {
+				memcpy(chars + used, name, len);
+				used += len;
+				count++;
+			}
+		}
+#if defined(_WIN32)
+		more = FindNextFileA(find, &data) != 0;
+	}
+	if (find != INVALID_HANDLE_VALUE) FindClose(find);
+#else
+	}
+	if (dir) closedir(dir);
+#endif
+
+	// Sorted, so results come out in a stable order and literal parts can be found by binary search
+	char** names = NULL;
+	if (ok && count > 0) {
+		names = CPPCAST(char**)VEX_MALLOC(count * sizeof(char*));
+		if (names) {
+			_VEX_NOTE_ALLOC(ctx, names, count * sizeof(char*));
+			char* c = chars;
+			for (int i = 0; i < count; ++i) {
+				names[i] = c;
+				c += strlen(c) + 1;
+			}
+			qsort(names, (size_t)count, sizeof(char*), _vex_compare_names);
+		}
+		else ok = false;
+	}
+	if (!ok) {
+		if (chars) VEX_FREE(chars);
+		return false;
+	}
+	listing->chars = chars;
+	listing->capacity_chars = capacity;
+	listing->names = names;
+	listing->num_names = count;
+	return true;
+}
+
+static const vex_dir_listing* _vex_list_dir(vex_ctx* ctx, const char* path, size_t len) {
+	// Each directory is read at most once per parse, however many patterns or parts go through it
+	const char* key = (len > 0) ? path : ".";
+	size_t key_len = (len > 0) ? len : 1;
+	uint32_t hash = _vex_name_hash(key, key_len);
+	int mask = ctx->capacity_dir_cache - 1;
+	if (ctx->capacity_dir_cache > 0) {
+		for (int i = (int)(hash & (uint32_t)mask); ctx->dir_cache[i].path; i = (i + 1) & mask) {
+			const vex_dir_listing* listing = &ctx->dir_cache[i];
+			if (listing->hash == hash && strlen(listing->path) == key_len && memcmp(listing->path, key, key_len) == 0) return listing;
+		}
+	}
+
+	// Open addressing kept at most half full
+	if ((ctx->num_dir_cache + 1) * 2 > ctx->capacity_dir_cache) {
+		int capacity = (ctx->capacity_dir_cache > 0) ? ctx->capacity_dir_cache * 2 : 16;
+		vex_dir_listing* table = CPPCAST(vex_dir_listing*)VEX_MALLOC(capacity * sizeof(vex_dir_listing));
+		if (!table) return NULL;
+		_VEX_NOTE_ALLOC(ctx, table, capacity * sizeof(vex_dir_listing));
+		memset(table, 0, capacity * sizeof(vex_dir_listing));
+		mask = capacity - 1;
+		for (int e = 0; e < ctx->capacity_dir_cache; ++e) {
+			if (!ctx->dir_cache[e].path) continue;
+			int i = (int)(ctx->dir_cache[e].hash & (uint32_t)mask);
+			while (table[i].path) i = (i + 1) & mask;
+			table[i] = ctx->dir_cache[e];
+		}
+		if (ctx->dir_cache) VEX_FREE(ctx->dir_cache);
+		ctx->dir_cache = table;
+		ctx->capacity_dir_cache = capacity;
+	}
+
+	vex_dir_listing listing;
+	memset(&listing, 0, sizeof(listing));
+	listing.path = _vex_strdup(ctx, key);
+	if (!listing.path) return NULL;
+	if (!_vex_read_dir(ctx, listing.path, &listing)) {
+		VEX_FREE(listing.path);
+		return NULL;
+	}
+	listing.hash = hash;
+	int i = (int)(hash & (uint32_t)mask);
+	while (ctx->dir_cache[i].path) i = (i + 1) & mask;
+	ctx->dir_cache[i] = listing;
+	ctx->num_dir_cache++;
+	return &ctx->dir_cache[i];
+}
+
+static bool _vex_add_str_value(vex_ctx* ctx, vex_arg_token* token, int flags, const char* str, const char* name, bool positional, int num) {
+	if ((flags & VEX_DESC_UTF8) && !_vex_check_utf8(ctx, str, name)) return false;
+	if (!_vex_add_converted(ctx, token, VEX_ARG_TYPE_STR, str)) return false;
+	return !(flags & _VEX_PATH_CHECKS) || _vex_note_path(ctx, flags, token, positional, num);
+}
+
+static bool _vex_glob_emit(_vex_glob* g, size_t len) {
+	// A trailing slash only matches directories, and keeps the slash like the shell does
+	if (g->dir_only) {
+		_vex_stat_info info;
+		if (_vex_stat(g->path, &info) != 0 || !_VEX_IS_DIR(info.st_mode)) return true;
+		if (len + 2 > sizeof(g->path)) {
+			_vex_set_status(g->ctx, VEX_STATUS_LIMIT_EXCEEDED, "Glob match too long for %s", g->name ? g->name : "argument");
+			return false;
+		}
+		g->path[len] = '/';
+		g->path[len + 1] = '\0';
+	}
+
+	// Matches are stored as they're found, straight into the token's values
+	if (!_vex_check_values(g->ctx, g->token->arg_count + 1, g->name)) return false;
+	g->matches++;
+	bool ok = _vex_add_str_value(g->ctx, g->token, g->flags, g->path, g->name, g->positional, g->num);
+	g->path[len] = '\0';
+	return ok;
+}
+
+static bool _vex_glob_append(_vex_glob* g, size_t len, const char* name, size_t* out) {
+	size_t name_len = strlen(name);
+	bool slash = len > 0 && g->path[len - 1] != '/';
+	if (len + slash + name_len + 1 > sizeof(g->path)) {
+		_vex_set_status(g->ctx, VEX_STATUS_LIMIT_EXCEEDED, "Glob match too long for %s", g->name ? g->name : "argument");
+		return false;
+	}
+	if (slash) g->path[len++] = '/';
+	memcpy(g->path + len, name, name_len + 1);
+	*out = len + name_len;
+	return true;
+}
+
+static bool _vex_glob_literal(_vex_glob* g, size_t len, const _vex_glob_part* part, size_t* out) {
+	// A part without wildcards is written straight onto the path, false if it doesn't fit
+	const _vex_glob_op* ops = &g->ops[part->first];
+	size_t slash = (len > 0 && g->path[len - 1] != '/') ? 1 : 0;
+	if (len + slash + (size_t)part->num_ops + 1 > sizeof(g->path)) return false;
+	if (slash) g->path[len++] = '/';
+	for (int i = 0; i < part->num_ops; ++i) g->path[len + i] = (char)ops[i].c;
+	*out = len + (size_t)part->num_ops;
+	g->path[*out] = '\0';
+	return true;
+}
+
+static bool _vex_glob_walk(_vex_glob* g, size_t len, int p) {
+	// path holds a directory that matched every part before p
+	if (p == g->num_parts) return _vex_glob_emit(g, len);
+	const _vex_glob_part* part = &g->parts[p];
+	const _vex_glob_op* ops = &g->ops[part->first];
+	const vex_dir_listing* listing = _vex_list_dir(g->ctx, g->path, len);
+	if (!listing) {
+		_vex_set_status(g->ctx, VEX_STATUS_BAD_ALLOC, NULL);
+		return false;
+	}
+	if (part->literal) {
+		// A name too long for the path can't be matched either
+		size_t next;
+		if (listing->num_names == 0 || !_vex_glob_literal(g, len, part, &next)) return true;
+		const char* key = g->path + next - part->num_ops;
+		bool ok = !bsearch(&key, listing->names, (size_t)listing->num_names, sizeof(char*), _vex_compare_names) || _vex_glob_walk(g, next, p + 1);
+		g->path[len] = '\0';
+		return ok;
+	}
+	for (int i = 0; i < listing->num_names; ++i) {
+		if (!_vex_glob_match(ops, part->num_ops, listing->names[i])) continue;
+		size_t next;
+		if (!_vex_glob_append(g, len, listing->names[i], &next) || !_vex_glob_walk(g, next, p + 1)) return false;
+
+		// The cache table may have moved while listing deeper directories
+		g->path[len] = '\0';
+		listing = _vex_list_dir(g->ctx, g->path, len);
+		if (!listing) return false;
+	}
+	return true;
+}
+
+static bool _vex_add_glob(vex_ctx* ctx, vex_arg_token* token, int flags, const char* pattern, const char* name, bool positional, int num) {
+	// Values without wildcards are stored as given, less any escapes
+	size_t len = strlen(pattern);
+	if (!_vex_has_glob(pattern)) {
+		if (!strchr(pattern, '\\')) return _vex_add_str_value(ctx, token, flags, pattern, name, positional, num);
+		char* literal = CPPCAST(char*)VEX_MALLOC(len + 1);
+		if (!literal) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, literal, len + 1);
+		_vex_glob_unescape(literal, pattern);
+		bool ok = _vex_add_str_value(ctx, token, flags, literal, name, positional, num);
+		VEX_FREE(literal);
+		return ok;
+	}
+	_vex_glob* g = CPPCAST(_vex_glob*)VEX_MALLOC(sizeof(_vex_glob) + len * (sizeof(_vex_glob_op) + sizeof(_vex_glob_part)));
+	if (!g) {
 		_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
 		return false;
 	}
-	token->arg = temp;
-	token->arg[token->arg_count++] = value;
+	_VEX_NOTE_ALLOC(ctx, g, sizeof(_vex_glob) + len * (sizeof(_vex_glob_op) + sizeof(_vex_glob_part)));
+	g->ctx = ctx;
+	g->token = token;
+	g->name = name;
+	g->flags = flags;
+	g->positional = positional;
+	g->num = num;
+	g->parts = CPPCAST(_vex_glob_part*)(void*)(g + 1);
+	g->ops = CPPCAST(_vex_glob_op*)(void*)(g->parts + len);
+	g->num_parts = _vex_glob_compile(pattern, g->ops, g->parts);
+	g->matches = 0;
+	g->dir_only = pattern[len - 1] == '/';
+
+	// Leading parts without wildcards are joined into the starting directory without listing anything
+	size_t start = 0;
+	g->path[0] = '\0';
+	if (pattern[0] == '/') g->path[start++] = '/';
+	int p = 0;
+	bool ok = true;
+	while (ok && p < g->num_parts - 1 && g->parts[p].literal) {
+		ok = _vex_glob_literal(g, start, &g->parts[p], &start);
+		if (!ok) _vex_set_status(ctx, VEX_STATUS_LIMIT_EXCEEDED, "Glob match too long for %s", name ? name : "argument");
+		p++;
+	}
+	g->path[start] = '\0';
+
+	// Each remaining part is a level of recursion
+	if (ok && g->num_parts - p > _VEX_GLOB_MAX_DEPTH) {
+		_vex_set_status(ctx, VEX_STATUS_LIMIT_EXCEEDED, "Glob pattern too deep for %s", name ? name : "argument");
+		ok = false;
+	}
+	ok = ok && _vex_glob_walk(g, start, p);
+
+	// Like the shell, a pattern that matches nothing is kept as it is
+	if (ok && g->matches == 0) ok = _vex_add_str_value(ctx, token, flags, pattern, name, positional, num);
+	VEX_FREE(g);
+	return ok;
+}
+
+static bool _vex_add_option_value(vex_ctx* ctx, _vex_parse_state* st, int type, const char* str) {
+	st->last_count++;
+	if (!_vex_check_values(ctx, st->last_count, ctx->arg_desc[st->last_desc].long_name)) return false;
+	if (st->hash) {
+		if (ctx->arg_hot[st->last_desc].flags & (VEX_DESC_GLOB | _VEX_PATH_CHECKS)) st->uses_fs = true;
+		_vex_hash_tag(st->hash, 'V', 0);
+		_vex_hash_bytes(st->hash, str, strlen(str));
+		return true;
+	}
+	int flags = ctx->arg_hot[st->last_desc].flags;
+	vex_arg_token* token = &ctx->arg_token[st->last_token];
+	const char* name = ctx->arg_desc[st->last_desc].long_name;
+	if (type != VEX_ARG_TYPE_STR) return _vex_add_converted(ctx, token, type, str);
+	if (flags & VEX_DESC_GLOB) return _vex_add_glob(ctx, token, flags, str, name, false, st->last_token);
+	return _vex_add_str_value(ctx, token, flags, str, name, false, st->last_token);
+}
+
+static bool _vex_parse_pass(vex_ctx* ctx, _vex_parse_state* st, int a) {
+	if (st->hash) {
+		_vex_hash_tag(st->hash, 'X', 0);
+		_vex_hash_bytes(st->hash, st->argv[a], strlen(st->argv[a]));
+		return true;
+	}
+
+	// Only the position is noted, argv isn't touched until the parse succeeds
+	if (st->num_pass >= ctx->capacity_pass_index) {
+		int capacity = (ctx->capacity_pass_index > 0) ? ctx->capacity_pass_index * 2 : 16;
+		int* index = CPPCAST(int*)VEX_REALLOC(ctx->pass_index, capacity * sizeof(int));
+		if (!index) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, index, capacity * sizeof(int));
+		ctx->pass_index = index;
+		ctx->capacity_pass_index = capacity;
+	}
+	ctx->pass_index[st->num_pass++] = a;
+	return true;
+}
+
+static _vex_parse_state _vex_parse_begin(int argc, char** argv, int first) {
+	_vex_parse_state state;
+	memset(&state, 0, sizeof(state));
+	state.argv = argv;
+	state.argc = argc;
+	state.first = first;
+	state.num_pass = 0;
+	state.last_desc = -1;
+	state.last_token = -1;
+	state.parse_options = true;
+	return state;
+}
+
+static bool _vex_parse_arg(vex_ctx* ctx, _vex_parse_state* st, char* arg, int a) {
+	// Pass-through needs the argv being parsed, so it only applies to vex_parse
+	bool pass_remainder = st->argv && (ctx->flags & VEX_FLAG_PASS_REMAINDER);
+	bool pass_unknown = st->argv && (ctx->flags & VEX_FLAG_PASS_UNKNOWN);
+
+	// Enforce input limits, only measuring the argument when a size limit is set
+	size_t len = (ctx->limits.max_arg_len > 0 || ctx->limits.max_total_bytes > 0) ? strlen(arg) : 0;
+	if (ctx->limits.max_arg_len > 0 && len > ctx->limits.max_arg_len) {
+		_vex_set_status(ctx, VEX_STATUS_LIMIT_EXCEEDED, "Argument too long (limit %lu bytes)", (unsigned long)ctx->limits.max_arg_len);
+		return false;
+	}
+	if (!_vex_check_input(ctx, st, 1, len + 1)) return false;
+
+	// Disable further option parsing
+	if (strcmp(arg, "--") == 0) {
+		if (st->parse_options && pass_remainder) {
+			// The remainder is handed off untouched, but still counts towards the limits
+			if (ctx->limits.max_args > 0 || ctx->limits.max_total_bytes > 0) {
+				size_t num_bytes = 0;
+				for (int r = a + 1; r < st->argc; ++r) num_bytes += st->argv[r] ? strlen(st->argv[r]) + 1 : 0;
+				if (!_vex_check_input(ctx, st, st->argc - a - 1, num_bytes)) return false;
+			}
+			if (st->hash) {
+				// Tagged apart from forwarded options, which end up in the same slice but mean something else; the
+				// separator is part of the slice too, so an empty remainder still differs from none
+				_vex_hash_tag(st->hash, 'R', -1);
+				for (int r = a + 1; r < st->argc; ++r) {
+					if (!st->argv[r]) continue;
+					_vex_hash_tag(st->hash, 'R', 0);
+					_vex_hash_bytes(st->hash, st->argv[r], strlen(st->argv[r]));
+				}
+				st->done = true;
+				return true;
+			}
+
+			// Hand off the separator and the remainder as a slice of argv, behind any forwarded options, so the
+			// slice parses the same way again
+			_vex_gather_pass(st->argv, st->first, a, ctx->pass_index, st->num_pass);
+			ctx->pass_argv = &st->argv[a - st->num_pass];
+			ctx->pass_argc = st->num_pass + (st->argc - a);
+			st->num_pass = 0;
+			st->done = true;
+			return true;
+		}
+		st->parse_options = false;
+		return true;
+	}
+
+	// Parse options
+	if (st->parse_options && arg[0] == '-') {
+		st->last_desc = -1;
+		st->last_token = -1;
+		if (arg[1] == '-') {
+			// Long option
+			size_t span = strcspn(&arg[2], "=");
+			_VEX_STAT_TIMER(start);
+			int d = _vex_find_long(ctx, &arg[2], span);
+			_VEX_STAT_TIME(ctx, lookup_ns, start);
+
+			// Check for unknown options
+			if (d < 0) {
+				if (pass_unknown) return _vex_parse_pass(ctx, st, a);
+				_vex_set_status(ctx, VEX_STATUS_UNKNOWN_ARG, "Unknown option: %s", arg);
+				return false;
+			}
+			if (!_vex_add_option(ctx, st, d)) return false;
+
+			// Check for value
+			int type = ctx->arg_hot[d].arg_type;
+			if (type != VEX_ARG_TYPE_FLAG && arg[2 + span] == '=') {
+				if (!_vex_add_option_value(ctx, st, type, &arg[3 + span])) return false;
+			}
+		}
+		else {
+			// Short option
+			for (const char* c = &arg[1]; *c != '\0'; ++c) {
+				_VEX_STAT_TIMER(start);
+				int d = _vex_find_short(ctx, *c);
+				_VEX_STAT_TIME(ctx, lookup_ns, start);
+				if (d >= 0) {
+					if (!_vex_add_option(ctx, st, d)) return false;
+					continue;
+				}
+
+				// An unknown character following a short option may not necessarily be an error; it could be the first
+				// character of a value for that option (e.g. -ifile.txt)
+				const vex_arg_hot* last = (st->last_desc >= 0) ? &ctx->arg_hot[st->last_desc] : NULL;
+				if (last && last->short_name != '\0' && last->arg_type != VEX_ARG_TYPE_FLAG) {
+					if (!_vex_add_option_value(ctx, st, last->arg_type, c)) return false;
+					break;
+				}
+				else if (c == &arg[1] && pass_unknown) {
+					if (!_vex_parse_pass(ctx, st, a)) return false;
+					break;
+				}
+				else {
+					_vex_set_status(ctx, VEX_STATUS_UNKNOWN_ARG, "Unknown option: -%c", *c);
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	_VEX_STAT_TIMER(validate_start);
+	bool group_with_last_token = false;
+	if (st->last_desc >= 0) {
+		const vex_arg_hot* hot = &ctx->arg_hot[st->last_desc];
+		if (hot->max_count < 0 || st->last_count < hot->max_count) group_with_last_token = true;
+	}
+	if (st->parse_options && group_with_last_token) {
+		// Add to last parsed option
+		int type = _vex_guess_type(arg);
+		_VEX_STAT_TIME(ctx, validate_ns, validate_start);
+		if (ctx->arg_hot[st->last_desc].arg_type != type) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Unexpected value");
+			return false;
+		}
+		if (!_vex_add_option_value(ctx, st, type, arg)) return false;
+	}
+	else if (st->pos_slot < ctx->num_pos_desc) {
+		// Fill the next declared slot, converting by its declared type
+		vex_pos_desc* desc = &ctx->pos_desc[st->pos_slot];
+		_VEX_STAT_TIME(ctx, validate_ns, validate_start);
+		if (!_vex_check_values(ctx, st->pos_count + 1, desc->name)) return false;
+		if (st->hash) {
+			if (desc->flags & (VEX_DESC_GLOB | _VEX_PATH_CHECKS)) st->uses_fs = true;
+			_vex_hash_tag(st->hash, 'P', st->pos_slot);
+			_vex_hash_bytes(st->hash, arg, strlen(arg));
+		}
+		else if (desc->arg_type == VEX_ARG_TYPE_STR && (desc->flags & VEX_DESC_GLOB)) {
+			if (!_vex_add_glob(ctx, &ctx->pos_token[st->pos_slot], desc->flags, arg, desc->name, true, st->pos_slot)) return false;
+		}
+		else {
+			if (desc->arg_type == VEX_ARG_TYPE_STR && (desc->flags & VEX_DESC_UTF8) && !_vex_check_utf8(ctx, arg, desc->name)) return false;
+			vex_value value = { 0 };
+			_VEX_STAT_TIMER(convert_start);
+			bool converted = _vex_convert_value(ctx, desc->arg_type, arg, desc->name, &value);
+			_VEX_STAT_TIME(ctx, convert_ns, convert_start);
+			if (!converted) return false;
+			VEX_TRACE_VALUE_CONVERTED(ctx, desc->arg_type, arg);
+			if (!_vec_token_add_value(ctx, &ctx->pos_token[st->pos_slot], value)) return false;
+			if (desc->arg_type == VEX_ARG_TYPE_STR && (desc->flags & _VEX_PATH_CHECKS) && !_vex_note_path(ctx, desc->flags, &ctx->pos_token[st->pos_slot], true, st->pos_slot)) return false;
+		}
+		st->pos_count++;
+		if (desc->max_count > 0 && st->pos_count >= desc->max_count) {
+			st->pos_slot++;
+			st->pos_count = 0;
+		}
+		st->last_token = -1;
+		st->last_desc = -1;
+	}
+	else {
+		// Add as a seperate token
+		_VEX_STAT_TIME(ctx, validate_ns, validate_start);
+		if (st->hash) {
+			_vex_hash_tag(st->hash, 'T', 0);
+			_vex_hash_bytes(st->hash, arg, strlen(arg));
+		}
+		else {
+			vex_arg_token token = { 0 };
+			token.arg_type = _vex_guess_type(arg);
+			if (!_vex_add_token(ctx, token)) return false;
+			if (!_vex_add_converted(ctx, &ctx->arg_token[ctx->num_arg_token - 1], token.arg_type, arg)) return false;
+		}
+		st->last_token = -1;
+		st->last_desc = -1;
+	}
+	return true;
+}
+
+static bool _vex_parse_run(vex_ctx* ctx, _vex_parse_state* st) {
+	for (int a = st->first; a < st->argc && !st->done; ++a) {
+		if (!st->argv[a]) continue;
+		_VEX_STAT_STEP_BEGIN(ctx);
+		bool parsed = _vex_parse_arg(ctx, st, st->argv[a], a);
+		_VEX_STAT_STEP_END(ctx);
+		if (!parsed) return false;
+	}
+	return true;
+}
+
+static void _vex_parse_end(vex_ctx* ctx, _vex_parse_state* st) {
+	// Move forwarded options to the end of argv so they form a single slice
+	if (!st->hash && st->num_pass > 0) {
+		_vex_gather_pass(st->argv, st->first, st->argc, ctx->pass_index, st->num_pass);
+		ctx->pass_argv = &st->argv[st->argc - st->num_pass];
+		ctx->pass_argc = st->num_pass;
+		st->num_pass = 0;
+	}
+}
+
+static bool _vex_token_open(vex_ctx* ctx, const _vex_parse_state* st) {
+	// Whether the last option token can still take values from the arguments that follow
+	if (!st->parse_options || st->last_token < 0 || st->last_desc < 0) return false;
+	const vex_arg_hot* hot = &ctx->arg_hot[st->last_desc];
+	return hot->max_count < 0 || st->last_count < hot->max_count;
+}
+
+static void _vex_rewind(vex_ctx* ctx, const vex_checkpoint* checkpoint) {
+	// Only results produced after the checkpoint are touched
+	ctx->num_arg_token = checkpoint->num_arg_token;
+	// Value counts rather than argument counts, since a glob can store many values for one argument
+	if (checkpoint->last_token >= 0) _vex_truncate_values(&ctx->arg_token[checkpoint->last_token], checkpoint->last_values);
+	for (int i = checkpoint->pos_slot; i < ctx->num_pos_desc; ++i) {
+		if (ctx->pos_token[i].arg_count == 0) break;
+		_vex_truncate_values(&ctx->pos_token[i], (i == checkpoint->pos_slot) ? checkpoint->pos_values : 0);
+	}
+	ctx->pass_argv = NULL;
+	ctx->pass_argc = 0;
+	ctx->pass_after_dash = false;
+	ctx->num_path_results = checkpoint->num_path_results;
+
+	// Strings copied after the checkpoint are overwritten by the next suffix
+	ctx->arena_cur = checkpoint->arena_chunk;
+	if (checkpoint->arena_chunk) checkpoint->arena_chunk->used = checkpoint->arena_used;
+	else _vex_arena_reset(ctx);
+}
+
+static bool _vex_next_word(char** cursor, char** word) {
+	// Skip leading whitespace; a line continuation is removed before words are split, so it counts as none
+	char* r = *cursor;
+	for (;;) {
+		if (*r == ' ' || *r == '\t' || *r == '\n' || *r == '\r') r++;
+		else if (r[0] == '\\' && r[1] == '\n') r += 2;
+		else break;
+	}
+	*word = NULL;
+	if (*r == '\0') {
+		*cursor = r;
+		return true;
+	}
+
+	// Unquote the word in place following POSIX shell rules; the result is never longer than the input
+	char* w = r;
+	*word = w;
+	char quote = '\0';
+	for (;;) {
+		char c = *r;
+		if (c == '\0') {
+			if (quote != '\0') return false;
+			break;
+		}
+		if (quote == '\'') {
+			// Everything is literal inside single quotes
+			r++;
+			if (c == '\'') quote = '\0';
+			else *w++ = c;
+		}
+		else if (quote == '"') {
+			// Backslash only escapes a few characters inside double quotes
+			r++;
+			if (c == '"') {
+				quote = '\0';
+			}
+			else if (c == '\\' && (*r == '$' || *r == '`' || *r == '"' || *r == '\\')) {
+				*w++ = *r++;
+			}
+			else if (c == '\\' && *r == '\n') {
+				r++;
+			}
+			else {
+				*w++ = c;
+			}
+		}
+		else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+			r++;
+			break;
+		}
+		else if (c == '\'' || c == '"') {
+			quote = c;
+			r++;
+		}
+		else if (c == '\\') {
+			// Escape the next character, or join lines
+			r++;
+			if (*r == '\n') r++;
+			else if (*r != '\0') *w++ = *r++;
+		}
+		else {
+			*w++ = c;
+			r++;
+		}
+	}
+	*w = '\0';
+	*cursor = r;
+	return true;
+}
+
+#define _VEX_GETOPT_PERMUTE 0
+#define _VEX_GETOPT_REQUIRE_ORDER 1
+#define _VEX_GETOPT_RETURN_IN_ORDER 2
+#define _VEX_GETOPT_NONOPTION(arg) ((arg)[0] != '-' || (arg)[1] == '\0')
+
+static int _vex_getopt_compare(const void* a, const void* b) {
+	const vex_getopt_entry* ea = (const vex_getopt_entry*)a;
+	const vex_getopt_entry* eb = (const vex_getopt_entry*)b;
+	int cmp = strcmp(ea->name, eb->name);
+	return (cmp != 0) ? cmp : ea->index - eb->index;
+}
+
+static bool _vex_getopt_tables(vex_getopt* state, const char* optstring, const vex_option* longopts) {
+	// Built once per option set, so each call looks options up instead of rescanning the definitions
+	if (state->long_table && state->optstring == optstring && state->longopts == longopts) return true;
+	state->optstring = optstring;
+	state->longopts = longopts;
+
+	// Ordering prefix, then a leading ':' to report missing arguments quietly
+	const char* spec = optstring;
+	state->ordering = _VEX_GETOPT_PERMUTE;
+	if (*spec == '+') {
+		state->ordering = _VEX_GETOPT_REQUIRE_ORDER;
+		spec++;
+	}
+	else if (*spec == '-') {
+		state->ordering = _VEX_GETOPT_RETURN_IN_ORDER;
+		spec++;
+	}
+	else if (getenv("POSIXLY_CORRECT")) state->ordering = _VEX_GETOPT_REQUIRE_ORDER;
+	state->missing_colon = (*spec == ':');
+
+	// Short options map straight to their argument requirement, offset by one so zero means unknown; "W;" makes
+	// -W take a long option as its argument
+	memset(state->short_table, 0, sizeof(state->short_table));
+	state->w_semicolon = false;
+	for (; *spec != '\0'; ++spec) {
+		if (*spec == ':' || *spec == ';') continue;
+		if (*spec == 'W' && spec[1] == ';') state->w_semicolon = true;
+		int has_arg = VEX_NO_ARGUMENT;
+		if (spec[1] == ':') has_arg = (spec[2] == ':') ? VEX_OPTIONAL_ARGUMENT : VEX_REQUIRED_ARGUMENT;
+		state->short_table[(unsigned char)*spec] = (unsigned char)(has_arg + 1);
+	}
+
+	// Long options sorted by name, so exact and abbreviated names are found by binary search
+	int num_long = 0;
+	while (longopts && longopts[num_long].name) num_long++;
+	if (num_long + 1 > state->capacity_long) {
+		vex_getopt_entry* table = CPPCAST(vex_getopt_entry*)VEX_REALLOC(state->long_table, (size_t)(num_long + 1) * sizeof(vex_getopt_entry));
+		if (!table) return false;
+		state->long_table = table;
+		state->capacity_long = num_long + 1;
+	}
+	for (int i = 0; i < num_long; ++i) {
+		state->long_table[i].name = longopts[i].name;
+		state->long_table[i].index = i;
+	}
+	qsort(state->long_table, (size_t)num_long, sizeof(vex_getopt_entry), _vex_getopt_compare);
+	state->num_long = num_long;
 	return true;
 }
 
+static int _vex_getopt_find_long(const vex_getopt* state, const char* name, size_t len, int* first, int* last) {
+	// Names sharing a prefix are adjacent once sorted, so the candidates form one range
+	const vex_getopt_entry* table = state->long_table;
+	int lo = 0;
+	int hi = state->num_long;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (strncmp(table[mid].name, name, len) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+	*first = lo;
+	*last = lo;
+	if (lo == state->num_long || strncmp(table[lo].name, name, len) != 0) return -1;
+	if (table[lo].name[len] == '\0') return table[lo].index;
+
+	// An abbreviation picks the earliest candidate, and is only ambiguous if the candidates behave differently
+	const vex_option* longopts = state->longopts;
+	int found = table[lo].index;
+	bool ambiguous = false;
+	for (*last = lo + 1; *last < state->num_long && strncmp(table[*last].name, name, len) == 0; ++(*last)) {
+		const vex_option* a = &longopts[found];
+		const vex_option* b = &longopts[table[*last].index];
+		if (a->has_arg != b->has_arg || a->flag != b->flag || a->val != b->val) ambiguous = true;
+		if (table[*last].index < found) found = table[*last].index;
+	}
+	return ambiguous ? -2 : found;
+}
+
+static void _vex_getopt_exchange(vex_getopt* state, char** argv) {
+	// Move the skipped non-options after the options parsed since
+	_vex_rotate_argv(&argv[state->first_nonopt], &argv[state->last_nonopt], &argv[state->optind]);
+	state->first_nonopt += state->optind - state->last_nonopt;
+	state->last_nonopt = state->optind;
+}
+
+static int _vex_getopt_long_option(vex_getopt* state, int argc, char** argv, int* longindex, const char* prefix) {
+	char* name = state->nextchar;
+	size_t len = strcspn(name, "=");
+	int first, last;
+	int index = _vex_getopt_find_long(state, name, len, &first, &last);
+	state->nextchar = NULL;
+	state->optind++;
+	if (index == -2) {
+		if (state->opterr && !state->missing_colon) {
+			fprintf(stderr, "%s: option '%s%s' is ambiguous; possibilities:", argv[0], prefix, name);
+			for (int e = first; e < last; ++e) fprintf(stderr, " '%s%s'", prefix, state->long_table[e].name);
+			fprintf(stderr, "\n");
+		}
+		state->optopt = 0;
+		return '?';
+	}
+	if (index < 0) {
+		if (state->opterr && !state->missing_colon) fprintf(stderr, "%s: unrecognized option '%s%s'\n", argv[0], prefix, name);
+		state->optopt = 0;
+		return '?';
+	}
+
+	const vex_option* opt = &state->longopts[index];
+	if (name[len] == '=') {
+		if (opt->has_arg == VEX_NO_ARGUMENT) {
+			if (state->opterr && !state->missing_colon) fprintf(stderr, "%s: option '%s%s' doesn't allow an argument\n", argv[0], prefix, opt->name);
+			state->optopt = opt->val;
+			return '?';
+		}
+		state->optarg = &name[len + 1];
+	}
+	else if (opt->has_arg == VEX_REQUIRED_ARGUMENT) {
+		if (state->optind >= argc) {
+			if (state->opterr && !state->missing_colon) fprintf(stderr, "%s: option '%s%s' requires an argument\n", argv[0], prefix, opt->name);
+			state->optopt = opt->val;
+			return state->missing_colon ? ':' : '?';
+		}
+		state->optarg = argv[state->optind++];
+	}
+	if (longindex) *longindex = index;
+	if (opt->flag) {
+		*opt->flag = opt->val;
+		return 0;
+	}
+	return opt->val;
+}
+
 bool vex_init(vex_ctx* ctx, vex_init_info init_info) {
 	if (!ctx) { return false; }
-	ctx->name = _vex_strdup(init_info.name);
+#ifdef VEX_ENABLE_STATS
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+#endif
+	ctx->name = _vex_strdup(ctx, init_info.name);
 	ctx->help_msg = NULL;
 	ctx->status_msg = NULL;
-	ctx->description = _vex_strdup(init_info.description);
-	ctx->version = _vex_strdup(init_info.version);
+	ctx->description = _vex_strdup(ctx, init_info.description);
+	ctx->version = _vex_strdup(ctx, init_info.version);
 	ctx->arg_desc = NULL;
+	ctx->arg_hot = NULL;
 	ctx->num_arg_desc = 0;
 	ctx->capacity_arg_desc = 0;
+	ctx->arg_index = NULL;
+	ctx->capacity_arg_index = 0;
+	memset(ctx->short_index, 0, sizeof(ctx->short_index));
+	ctx->groups = NULL;
+	ctx->num_groups = 0;
+	ctx->capacity_groups = 0;
+	ctx->group_index = NULL;
+	ctx->capacity_group_index = 0;
+	ctx->free_desc = NULL;
+	ctx->num_free_desc = 0;
+	ctx->schema_version = 0;
+	ctx->schema_hash_version = -1;
+	ctx->pos_desc = NULL;
+	ctx->pos_token = NULL;
+	ctx->num_pos_desc = 0;
+	ctx->capacity_pos_desc = 0;
 	ctx->arg_token = NULL;
 	ctx->num_arg_token = 0;
 	ctx->capacity_arg_token = 0;
+	ctx->pass_argv = NULL;
+	ctx->pass_argc = 0;
+	ctx->pass_after_dash = false;
+	ctx->pass_index = NULL;
+	ctx->capacity_pass_index = 0;
+	ctx->path_results = NULL;
+	ctx->num_path_results = 0;
+	ctx->capacity_path_results = 0;
+	ctx->dir_cache = NULL;
+	ctx->num_dir_cache = 0;
+	ctx->capacity_dir_cache = 0;
+	ctx->arena = NULL;
+	ctx->arena_cur = NULL;
+	ctx->intern = NULL;
+	ctx->num_intern = 0;
+	ctx->capacity_intern = 0;
+	ctx->intern_pool = NULL;
+	memset(&ctx->limits, 0, sizeof(ctx->limits));
+	ctx->usage = NULL;
+	ctx->usage_shard = NULL;
+	ctx->flags = init_info.flags;
+	ctx->generation = 0;
 	ctx->status = VEX_STATUS_OK;
+	ctx->status_offset = 0;
 
 	// Validate
 	if (!ctx->name || !ctx->description || !ctx->version) {
@@ -225,23 +2878,57 @@ bool vex_init(vex_ctx* ctx, vex_init_info init_info) {
 	// Add default arguments
 	vex_arg_desc arg_help_flag = { 0 };
 	arg_help_flag.arg_type = VEX_ARG_TYPE_FLAG;
-	arg_help_flag.long_name = _vex_strdup("help");
+	arg_help_flag.long_name = CPPCAST(char*)"help";
 	arg_help_flag.short_name = 'h';
-	arg_help_flag.description = _vex_strdup("Print this help message");
+	arg_help_flag.description = CPPCAST(char*)"Print this help message";
 	arg_help_flag.max_count = 0;
 	vex_add_arg(ctx, arg_help_flag);
 
 	vex_arg_desc arg_ver_flag = { 0 };
 	arg_ver_flag.arg_type = VEX_ARG_TYPE_FLAG;
-	arg_ver_flag.long_name = _vex_strdup("version");
+	arg_ver_flag.long_name = CPPCAST(char*)"version";
 	arg_ver_flag.short_name = 'v';
-	arg_ver_flag.description = _vex_strdup("Print the version string");
+	arg_ver_flag.description = CPPCAST(char*)"Print the version string";
 	arg_ver_flag.max_count = 0;
 	vex_add_arg(ctx, arg_ver_flag);
 
 	return true;
 }
 
+static bool _vex_reserve_arg_desc(vex_ctx* ctx, int count) {
+	// Descriptors and their hot records grow together, and so does the list of free slots once groups use it
+	while (count > ctx->capacity_arg_desc) {
+		int new_capacity = ctx->capacity_arg_desc * 2;
+		new_capacity += (new_capacity == 0);
+		vex_arg_desc* temp = CPPCAST(vex_arg_desc*)VEX_REALLOC(ctx->arg_desc, new_capacity * sizeof(*temp));
+		if (!temp) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, temp, new_capacity * sizeof(*temp));
+		memset(&temp[ctx->capacity_arg_desc], 0, (new_capacity - ctx->capacity_arg_desc) * sizeof(*temp));
+		ctx->arg_desc = temp;
+		vex_arg_hot* hot = CPPCAST(vex_arg_hot*)VEX_REALLOC(ctx->arg_hot, new_capacity * sizeof(*hot));
+		if (!hot) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, hot, new_capacity * sizeof(*hot));
+		ctx->arg_hot = hot;
+		if (ctx->free_desc) {
+			int* free_desc = CPPCAST(int*)VEX_REALLOC(ctx->free_desc, new_capacity * sizeof(int));
+			if (!free_desc) {
+				_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+				return false;
+			}
+			_VEX_NOTE_ALLOC(ctx, free_desc, new_capacity * sizeof(int));
+			ctx->free_desc = free_desc;
+		}
+		ctx->capacity_arg_desc = new_capacity;
+	}
+	return true;
+}
+
 bool vex_add_arg(vex_ctx* ctx, vex_arg_desc desc) {
 	// Validate arg
 	if (!isalpha(desc.short_name)) {
@@ -255,6 +2942,7 @@ bool vex_add_arg(vex_ctx* ctx, vex_arg_desc desc) {
 
 	// Look for duplicates
 	for (int i = 0; i < ctx->num_arg_desc; ++i) {
+		if (ctx->arg_hot[i].flags & _VEX_HOT_REMOVED) continue;
 		if (ctx->arg_desc[i].short_name == desc.short_name ||
 			strcmp(ctx->arg_desc[i].long_name, desc.long_name) == 0) {
 			if (desc.short_name == '\0') {
@@ -268,201 +2956,476 @@ bool vex_add_arg(vex_ctx* ctx, vex_arg_desc desc) {
 	}
 
 	// Resize arg descriptor buffer if needed
-	while (ctx->num_arg_desc >= ctx->capacity_arg_desc) {
-		int new_capacity = ctx->capacity_arg_desc * 2;
+	if (!_vex_reserve_arg_desc(ctx, ctx->num_arg_desc + 1)) return false;
+
+	// Copy to description buffer
+	vex_arg_desc* slot = &ctx->arg_desc[ctx->num_arg_desc];
+	slot->arg_type = desc.arg_type;
+	slot->short_name = desc.short_name;
+	slot->long_name = _vex_strdup(ctx, desc.long_name);
+	slot->description = _vex_strdup(ctx, desc.description);
+	slot->max_count = desc.max_count;
+	slot->flags = desc.flags;
+
+	// Everything a lookup or parse step reads goes in the hot array, descriptions stay behind for help text
+	vex_arg_hot* hot = &ctx->arg_hot[ctx->num_arg_desc];
+	memset(hot, 0, sizeof(*hot));
+	hot->name_len = desc.long_name ? (uint32_t)strlen(desc.long_name) : 0;
+	hot->name_hash = _vex_name_hash(desc.long_name, hot->name_len);
+	hot->max_count = desc.max_count;
+	hot->arg_type = (int8_t)desc.arg_type;
+	hot->short_name = desc.short_name;
+	hot->flags = (uint16_t)desc.flags;
+	if ((desc.long_name && !slot->long_name) || (desc.description && !slot->description) || !_vex_index_add(ctx, ctx->num_arg_desc)) {
+		// The slot isn't counted yet, so nothing else would free its copies
+		if (slot->long_name) VEX_FREE(slot->long_name);
+		if (slot->description) VEX_FREE(slot->description);
+		memset(slot, 0, sizeof(*slot));
+		_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+		return false;
+	}
+	if ((unsigned char)desc.short_name < 128) ctx->short_index[(unsigned char)desc.short_name] = (int16_t)(ctx->num_arg_desc + 1);
+	ctx->num_arg_desc++;
+	ctx->schema_version++;
+	if (ctx->help_msg) VEX_FREE(ctx->help_msg);
+	ctx->help_msg = NULL;
+	return true;
+}
+
+bool vex_add_pos(vex_ctx* ctx, vex_pos_desc desc) {
+	// Validate slot
+	if (!desc.name || desc.name[0] == '\0') {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "No positional name given");
+		return false;
+	}
+	if (desc.arg_type != VEX_ARG_TYPE_INT && desc.arg_type != VEX_ARG_TYPE_DUB && desc.arg_type != VEX_ARG_TYPE_STR) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Invalid positional type: %s", desc.name);
+		return false;
+	}
+	if (ctx->num_pos_desc > 0 && ctx->pos_desc[ctx->num_pos_desc - 1].max_count < 0) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Positional follows unbounded positional: %s", desc.name);
+		return false;
+	}
+
+	// Look for duplicates
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		if (strcmp(ctx->pos_desc[i].name, desc.name) == 0) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Duplicate positionals: %s", desc.name);
+			return false;
+		}
+	}
+
+	// Resize slot buffers if needed
+	while (ctx->num_pos_desc >= ctx->capacity_pos_desc) {
+		int new_capacity = ctx->capacity_pos_desc * 2;
 		new_capacity += (new_capacity == 0);
-		vex_arg_desc* temp = CPPCAST(vex_arg_desc*)VEX_REALLOC(ctx->arg_desc, new_capacity * sizeof(*temp));
-		if (!temp) {
+		vex_pos_desc* temp_desc = CPPCAST(vex_pos_desc*)VEX_REALLOC(ctx->pos_desc, new_capacity * sizeof(*temp_desc));
+		if (!temp_desc) {
 			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
 			return false;
 		}
-		memset(&temp[ctx->capacity_arg_desc], 0, (new_capacity - ctx->capacity_arg_desc) * sizeof(*temp));
-		ctx->arg_desc = temp;
-		ctx->capacity_arg_desc = new_capacity;
+		ctx->pos_desc = temp_desc;
+		_VEX_NOTE_ALLOC(ctx, temp_desc, new_capacity * sizeof(*temp_desc));
+		vex_arg_token* temp_token = CPPCAST(vex_arg_token*)VEX_REALLOC(ctx->pos_token, new_capacity * sizeof(*temp_token));
+		if (!temp_token) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		ctx->pos_token = temp_token;
+		_VEX_NOTE_ALLOC(ctx, temp_token, new_capacity * sizeof(*temp_token));
+		memset(&temp_desc[ctx->capacity_pos_desc], 0, (new_capacity - ctx->capacity_pos_desc) * sizeof(*temp_desc));
+		memset(&temp_token[ctx->capacity_pos_desc], 0, (new_capacity - ctx->capacity_pos_desc) * sizeof(*temp_token));
+		ctx->capacity_pos_desc = new_capacity;
 	}
 
-	// Copy to description buffer
-	ctx->arg_desc[ctx->num_arg_desc].arg_type = desc.arg_type;
-	ctx->arg_desc[ctx->num_arg_desc].short_name = desc.short_name;
-	ctx->arg_desc[ctx->num_arg_desc].long_name = _vex_strdup(desc.long_name);
-	ctx->arg_desc[ctx->num_arg_desc].description = _vex_strdup(desc.description);
-	ctx->arg_desc[ctx->num_arg_desc].max_count = desc.max_count;
-	ctx->num_arg_desc++;
+	// Copy to description buffer, a slot takes a single value unless told otherwise
+	vex_pos_desc* slot = &ctx->pos_desc[ctx->num_pos_desc];
+	slot->arg_type = desc.arg_type;
+	slot->name = _vex_strdup(ctx, desc.name);
+	slot->description = _vex_strdup(ctx, desc.description);
+	slot->max_count = (desc.max_count == 0) ? 1 : desc.max_count;
+	slot->flags = desc.flags;
+
+	// Slot tokens live as long as the slot, only their values are reset between parses
+	vex_arg_token* token = &ctx->pos_token[ctx->num_pos_desc];
+	memset(token, 0, sizeof(*token));
+	token->long_name = slot->name;
+	token->arg_type = slot->arg_type;
+	ctx->num_pos_desc++;
+	ctx->schema_version++;
+	if (ctx->help_msg) VEX_FREE(ctx->help_msg);
+	ctx->help_msg = NULL;
+	return true;
+}
+
+static void _vex_group_release(vex_ctx* ctx, int g) {
+	// Member slots become free for later groups; nothing else moves, so other descriptors keep their indices
+	vex_group* group = &ctx->groups[g];
+	for (int m = 0; m < group->num_members; ++m) {
+		int d = group->members[m];
+		vex_arg_desc* desc = &ctx->arg_desc[d];
+		unsigned char short_name = (unsigned char)desc->short_name;
+		if (short_name != 0 && short_name < 128 && ctx->short_index[short_name] == d + 1) ctx->short_index[short_name] = 0;
+		VEX_FREE(desc->long_name);
+		if (desc->description) VEX_FREE(desc->description);
+		memset(desc, 0, sizeof(*desc));
+
+		// The slot may be reused by another group, which must not inherit this option's counts
+		if (ctx->usage && d < ctx->usage->num_counters) {
+			vex_usage* usage = ctx->usage;
+			for (int s = 0; s < usage->num_shards; ++s) _vex_reset_count(&usage->counters[(size_t)s * (size_t)usage->stride + (size_t)d]);
+		}
+		memset(&ctx->arg_hot[d], 0, sizeof(vex_arg_hot));
+		ctx->arg_hot[d].flags = _VEX_HOT_REMOVED;
+		ctx->free_desc[ctx->num_free_desc++] = d;
+	}
+	if (group->members) VEX_FREE(group->members);
+	if (group->index) VEX_FREE(group->index);
+	if (group->prefix) VEX_FREE(group->prefix);
+	memset(group, 0, sizeof(*group));
+}
+
+static void _vex_group_reindex(vex_ctx* ctx) {
+	memset(ctx->group_index, 0xff, ctx->capacity_group_index * sizeof(int));
+	for (int g = 0; g < ctx->num_groups; ++g) {
+		if (ctx->groups[g].prefix) _vex_index_put(ctx->group_index, ctx->capacity_group_index, ctx->groups[g].prefix_hash, g);
+	}
+}
+
+static bool _vex_group_check(vex_ctx* ctx, const char* prefix, size_t prefix_len, const vex_arg_desc* descs, int count) {
+	// Local names must be plain words, unique within the group and not already taken by an option outside it
+	if (_vex_find_group(ctx, prefix, prefix_len, _vex_name_hash(prefix, prefix_len)) >= 0) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Duplicate option group: %s", prefix);
+		return false;
+	}
+	for (int i = 0; i < count; ++i) {
+		const vex_arg_desc* desc = &descs[i];
+		if (!desc->long_name || !desc->long_name[0] || strchr(desc->long_name, '.')) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Invalid option name in group %s", prefix);
+			return false;
+		}
+		if (desc->short_name != '\0' && (!isalpha((unsigned char)desc->short_name) || _vex_find_short(ctx, desc->short_name) >= 0)) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Duplicate arguments: -%c", desc->short_name);
+			return false;
+		}
+		for (int j = 0; j < i; ++j) {
+			if (strcmp(descs[j].long_name, desc->long_name) == 0 || (desc->short_name != '\0' && descs[j].short_name == desc->short_name)) {
+				_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Duplicate arguments: --%s.%s", prefix, desc->long_name);
+				return false;
+			}
+		}
+	}
+	for (int d = 0; d < ctx->num_arg_desc; ++d) {
+		const char* name = ctx->arg_desc[d].long_name;
+		if ((ctx->arg_hot[d].flags & (_VEX_HOT_GROUPED | _VEX_HOT_REMOVED)) || !name) continue;
+		if (strncmp(name, prefix, prefix_len) != 0 || name[prefix_len] != '.') continue;
+		for (int i = 0; i < count; ++i) {
+			if (strcmp(name + prefix_len + 1, descs[i].long_name) == 0) {
+				_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Duplicate arguments: --%s", name);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool _vex_group_reserve(vex_ctx* ctx, int count, int* slot) {
+	// Room for the descriptors, a group slot and its namespace entry, so committing the group can't run out halfway
+	int fresh = (count > ctx->num_free_desc) ? count - ctx->num_free_desc : 0;
+	if (!_vex_reserve_arg_desc(ctx, ctx->num_arg_desc + fresh)) return false;
+	if (!ctx->free_desc && ctx->capacity_arg_desc > 0) {
+		ctx->free_desc = CPPCAST(int*)VEX_MALLOC(ctx->capacity_arg_desc * sizeof(int));
+		if (!ctx->free_desc) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, ctx->free_desc, ctx->capacity_arg_desc * sizeof(int));
+	}
+
+	// Slots of removed groups are reused
+	int live = 0;
+	*slot = -1;
+	for (int g = 0; g < ctx->num_groups; ++g) {
+		if (ctx->groups[g].prefix) live++;
+		else if (*slot < 0) *slot = g;
+	}
+	if (*slot < 0 && ctx->num_groups == ctx->capacity_groups) {
+		int capacity = (ctx->capacity_groups > 0) ? ctx->capacity_groups * 2 : 4;
+		vex_group* groups = CPPCAST(vex_group*)VEX_REALLOC(ctx->groups, capacity * sizeof(vex_group));
+		if (!groups) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, groups, capacity * sizeof(vex_group));
+		ctx->groups = groups;
+		ctx->capacity_groups = capacity;
+	}
+	if (*slot < 0) *slot = ctx->num_groups;
+
+	// The namespace index is kept at most half full
+	if ((live + 1) * 2 > ctx->capacity_group_index) {
+		int capacity = (ctx->capacity_group_index > 0) ? ctx->capacity_group_index * 2 : 8;
+		int* index = CPPCAST(int*)VEX_MALLOC(capacity * sizeof(int));
+		if (!index) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+			return false;
+		}
+		_VEX_NOTE_ALLOC(ctx, index, capacity * sizeof(int));
+		if (ctx->group_index) VEX_FREE(ctx->group_index);
+		ctx->group_index = index;
+		ctx->capacity_group_index = capacity;
+		_vex_group_reindex(ctx);
+	}
+	return true;
+}
+
+int vex_add_group(vex_ctx* ctx, const char* prefix, const vex_arg_desc* descs, int count) {
+	// All options of a group are added together, or none of them
+	if (!prefix || !prefix[0] || count < 0 || (count > 0 && !descs)) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Invalid option group");
+		return -1;
+	}
+	size_t prefix_len = strlen(prefix);
+	int g;
+	if (!_vex_group_check(ctx, prefix, prefix_len, descs, count) || !_vex_group_reserve(ctx, count, &g)) return -1;
+
+	vex_group* group = &ctx->groups[g];
+	memset(group, 0, sizeof(*group));
+	if (g == ctx->num_groups) ctx->num_groups++;
+	int capacity = 8;
+	while (capacity < count * 2) capacity *= 2;
+	group->prefix = _vex_strdup(ctx, prefix);
+	group->members = CPPCAST(int*)VEX_MALLOC((count > 0 ? count : 1) * sizeof(int));
+	group->index = CPPCAST(int*)VEX_MALLOC(capacity * sizeof(int));
+	bool ok = group->prefix && group->members && group->index;
+	if (ok) {
+		_VEX_NOTE_ALLOC(ctx, group->members, (count > 0 ? count : 1) * sizeof(int));
+		_VEX_NOTE_ALLOC(ctx, group->index, capacity * sizeof(int));
+		memset(group->index, 0xff, capacity * sizeof(int));
+		group->prefix_len = (uint32_t)prefix_len;
+		group->prefix_hash = _vex_name_hash(prefix, prefix_len);
+		group->capacity_index = capacity;
+	}
+
+	// Members go by their full dotted name everywhere, so tokens, help text and lookups need no special cases
+	for (int i = 0; ok && i < count; ++i) {
+		const vex_arg_desc* desc = &descs[i];
+		size_t len = prefix_len + 1 + strlen(desc->long_name);
+		char* name = CPPCAST(char*)VEX_MALLOC(len + 1);
+		char* description = _vex_strdup(ctx, desc->description);
+		if (!name || (desc->description && !description)) {
+			if (name) VEX_FREE(name);
+			if (description) VEX_FREE(description);
+			ok = false;
+			break;
+		}
+		_VEX_NOTE_ALLOC(ctx, name, len + 1);
+		snprintf(name, len + 1, "%s.%s", prefix, desc->long_name);
+
+		int d = (ctx->num_free_desc > 0) ? ctx->free_desc[--ctx->num_free_desc] : ctx->num_arg_desc++;
+		vex_arg_desc* slot = &ctx->arg_desc[d];
+		slot->description = description;
+		slot->long_name = name;
+		slot->short_name = desc->short_name;
+		slot->arg_type = desc->arg_type;
+		slot->max_count = desc->max_count;
+		slot->flags = desc->flags;
+		vex_arg_hot* hot = &ctx->arg_hot[d];
+		memset(hot, 0, sizeof(*hot));
+		hot->name_len = (uint32_t)len;
+		hot->name_hash = _vex_name_hash(name, len);
+		hot->max_count = desc->max_count;
+		hot->arg_type = (int8_t)desc->arg_type;
+		hot->short_name = desc->short_name;
+		hot->flags = (uint16_t)(desc->flags | _VEX_HOT_GROUPED);
+		if (desc->short_name != '\0') ctx->short_index[(unsigned char)desc->short_name] = (int16_t)(d + 1);
+		group->members[group->num_members++] = d;
+		_vex_index_put(group->index, capacity, hot->name_hash, d);
+	}
+	if (!ok) {
+		_vex_group_release(ctx, g);
+		_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+		return -1;
+	}
+
+	_vex_index_put(ctx->group_index, ctx->capacity_group_index, group->prefix_hash, g);
+	ctx->schema_version++;
+	if (ctx->help_msg) VEX_FREE(ctx->help_msg);
+	ctx->help_msg = NULL;
+	return g;
+}
+
+bool vex_remove_group(vex_ctx* ctx, int group) {
+	if (group < 0 || group >= ctx->num_groups || !ctx->groups[group].prefix) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Invalid option group");
+		return false;
+	}
+
+	// Tokens may point at the names being released
+	_vex_clear_tokens(ctx);
+	_vex_group_release(ctx, group);
+	_vex_group_reindex(ctx);
+	ctx->schema_version++;
 	if (ctx->help_msg) VEX_FREE(ctx->help_msg);
 	ctx->help_msg = NULL;
 	return true;
 }
 
+void vex_set_limits(vex_ctx* ctx, vex_limits limits) {
+	// Limits decide which command lines parse, so cached results keyed on the old ones must not match
+	ctx->limits = limits;
+	ctx->schema_version++;
+}
+
 bool vex_parse(vex_ctx* ctx, int argc, char** argv) {
 	// Clear any existing parsing results
-	if (ctx->arg_token) VEX_FREE(ctx->arg_token);
-	ctx->num_arg_token = 0;
-	ctx->capacity_arg_token = 0;
+	_vex_clear_tokens(ctx);
+
+	// Parse arguments
+	_vex_parse_state state = _vex_parse_begin(argc, argv, 1);
+	if (!_vex_parse_run(ctx, &state)) return false;
+	_vex_parse_end(ctx, &state);
+	return true;
+}
+
+bool vex_parse_string(vex_ctx* ctx, char* str) {
+	// Clear any existing parsing results
+	_vex_clear_tokens(ctx);
+	if (!str) return true;
+
+	// Split the buffer in place and parse each word as soon as it's found
+	_vex_parse_state state = _vex_parse_begin(0, NULL, 0);
+	char* cursor = str;
+	for (;;) {
+		char* word = NULL;
+		_VEX_STAT_STEP_BEGIN(ctx);
+		if (!_vex_next_word(&cursor, &word)) {
+			_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Unterminated quote");
+			return false;
+		}
+		if (!word) break;
+		bool parsed = _vex_parse_arg(ctx, &state, word, 0);
+		_VEX_STAT_STEP_END(ctx);
+		if (!parsed) return false;
+	}
+	return true;
+}
+
+bool vex_parse_prefix(vex_ctx* ctx, int argc, char** argv, vex_checkpoint* checkpoint) {
+	// Clear any existing parsing results
+	_vex_clear_tokens(ctx);
+
+	// Parse the shared prefix as usual
+	_vex_parse_state state = _vex_parse_begin(argc, argv, 1);
+	if (!_vex_parse_run(ctx, &state)) return false;
+	_vex_parse_end(ctx, &state);
+	if (ctx->pass_argc > (state.done ? 1 : 0)) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Pass-through arguments in parse prefix");
+		return false;
+	}
 
-	// Parse arguments
-	int last_desc = -1;
-	int last_token = -1;
-	int token_count = 0;
-	bool parse_options = true;
-	for (int a = 1; a < argc; ++a) {
-		char* arg = argv[a];
-		if (!arg) continue;
+	// Save where the parser stopped
+	checkpoint->generation = ctx->generation;
+	checkpoint->num_arg_token = ctx->num_arg_token;
+	checkpoint->last_desc = state.last_desc;
+	checkpoint->last_token = state.last_token;
+	checkpoint->last_count = state.last_count;
+	checkpoint->last_values = (state.last_token >= 0) ? ctx->arg_token[state.last_token].arg_count : 0;
+	checkpoint->pos_slot = state.pos_slot;
+	checkpoint->pos_count = state.pos_count;
+	checkpoint->pos_values = (state.pos_slot < ctx->num_pos_desc) ? ctx->pos_token[state.pos_slot].arg_count : 0;
+	checkpoint->num_args = state.num_args;
+	checkpoint->total_bytes = state.total_bytes;
+	checkpoint->num_path_results = ctx->num_path_results;
+	checkpoint->arena_chunk = ctx->arena_cur;
+	checkpoint->arena_used = ctx->arena_cur ? ctx->arena_cur->used : 0;
+	checkpoint->parse_options = state.parse_options;
+	checkpoint->pass_remainder = state.done;
+	return true;
+}
 
-		// Disable further option parsing
-		if (strcmp(arg, "--") == 0) {
-			parse_options = false;
-			continue;
-		}
+bool vex_parse_suffix(vex_ctx* ctx, const vex_checkpoint* checkpoint, int argc, char** argv) {
+	if (checkpoint->generation != ctx->generation) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Stale parse checkpoint");
+		return false;
+	}
 
-		// Parse options
-		if (parse_options && arg[0] == '-') {
-			last_desc = -1;
-			last_token = -1;
-			token_count = 0;
-			if (arg[1] == '-') {
-				vex_arg_token token = { 0 };
-
-				// Long option
-				for (int d = 0; d < ctx->num_arg_desc; ++d) {
-					size_t span = strcspn(&arg[2], "=");
-					if (strncmp(&arg[2], ctx->arg_desc[d].long_name, span) == 0) {
-						token.short_name = ctx->arg_desc[d].short_name;
-						token.long_name = _vex_strdup(ctx->arg_desc[d].long_name);
-						token.arg_type = ctx->arg_desc[d].arg_type;
-						last_desc = d;
-						break;
-					}
-				}
+	// Drop the previous suffix's results
+	_vex_rewind(ctx, checkpoint);
+	if (checkpoint->pass_remainder) {
+		// The separator stays behind in the prefix's argv
+		ctx->pass_argv = argv;
+		ctx->pass_argc = argc;
+		ctx->pass_after_dash = true;
+		return true;
+	}
 
-				// Check for unknown options
-				if (!token.long_name) {
-					_vex_set_status(ctx, VEX_STATUS_UNKNOWN_ARG, "Unknown option: %s", arg);
-					return false;
-				}
+	// Resume from the saved state; the suffix has no program name
+	_vex_parse_state state = _vex_parse_begin(argc, argv, 0);
+	state.last_desc = checkpoint->last_desc;
+	state.last_token = checkpoint->last_token;
+	state.last_count = checkpoint->last_count;
+	state.pos_slot = checkpoint->pos_slot;
+	state.pos_count = checkpoint->pos_count;
+	state.num_args = checkpoint->num_args;
+	state.total_bytes = checkpoint->total_bytes;
+	state.parse_options = checkpoint->parse_options;
+	if (!_vex_parse_run(ctx, &state)) return false;
+	_vex_parse_end(ctx, &state);
+	return true;
+}
 
-				// Check for value
-				if (token.arg_type != VEX_ARG_TYPE_FLAG) {
-					const char* pch = strchr(arg, '=');
-					if (pch) {
-						vex_value value = { 0 };
-						switch (token.arg_type) {
-						case VEX_ARG_TYPE_INT: value.int_arg = atoi(pch + 1); break;
-						case VEX_ARG_TYPE_DUB: value.dub_arg = atof(pch + 1); break;
-						case VEX_ARG_TYPE_STR: value.str_arg = _vex_strdup(pch + 1); break;
-						}
-						if (!_vec_token_add_value(ctx, &token, value)) return false;
-					}
-				}
+void vex_stream_begin(vex_ctx* ctx, vex_stream* stream, int argc, char** argv) {
+	// Clear any existing parsing results
+	_vex_clear_tokens(ctx);
+	ctx->status = VEX_STATUS_OK;
+	ctx->status_offset = 0;
+	stream->state = _vex_parse_begin(argc, argv, 1);
+	stream->generation = ctx->generation;
+	stream->next_arg = 1;
+	stream->next_token = 0;
+	stream->next_slot = 0;
+	stream->finished = false;
+}
 
-				// Save to buffer
-				if (!_vex_add_token(ctx, token)) return false;
-				last_token = ctx->num_arg_token - 1;
-				token_count++;
-			}
-			else {
-				// Short option
-				for (const char* c = &arg[1]; *c != '\0'; ++c) {
-					vex_arg_token token = { 0 };
-
-					// Check for flag name
-					for (int d = 0; d < ctx->num_arg_desc; ++d) {
-						assert(ctx->arg_desc);
-						if (*c == ctx->arg_desc[d].short_name) {
-							token.short_name = ctx->arg_desc[d].short_name;
-							token.long_name = _vex_strdup(ctx->arg_desc[d].long_name);
-							token.arg_type = ctx->arg_desc[d].arg_type;
-							last_desc = d;
-							break;
-						}
-					}
-
-					// Check for unknown options
-					if (token.short_name == '\0') {
-						// An unknown character following a short option may not necessarily be an error; it could be the first
-						// character of a value for that option (e.g. -ifile.txt)
-						if (last_token >= 0 && ctx->arg_token[last_token].short_name != '\0' && ctx->arg_token[last_token].arg_type != VEX_ARG_TYPE_FLAG) {
-							// Check for value
-							vex_value value = { 0 };
-							vex_arg_token* token = &ctx->arg_token[last_token];
-							switch (token->arg_type) {
-							case VEX_ARG_TYPE_INT: value.int_arg = atoi(c); break;
-							case VEX_ARG_TYPE_DUB: value.dub_arg = atof(c); break;
-							case VEX_ARG_TYPE_STR: value.str_arg = _vex_strdup(c); break;
-							}
-							if (!_vec_token_add_value(ctx, token, value)) return false;
-							break;
-						}
-						else {
-							_vex_set_status(ctx, VEX_STATUS_UNKNOWN_ARG, "Unknown option: -%c", *c);
-							return false;
-						}
-					}
-					else {
-						// Save to buffer
-						if (!_vex_add_token(ctx, token)) return false;
-						last_token = ctx->num_arg_token - 1;
-						token_count++;
-					}
-				}
-			}
+const vex_arg_token* vex_stream_next(vex_ctx* ctx, vex_stream* stream, int* slot) {
+	if (stream->generation != ctx->generation) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Stale parse stream");
+		return NULL;
+	}
+	_vex_parse_state* st = &stream->state;
+	for (;;) {
+		// Hand out tokens once nothing more can be added to them
+		bool end = st->done || stream->next_arg >= st->argc;
+		if (stream->next_token < ctx->num_arg_token &&
+			(end || stream->next_token < ctx->num_arg_token - 1 || !_vex_token_open(ctx, st))) {
+			*slot = -1;
+			return &ctx->arg_token[stream->next_token++];
+		}
+		if (stream->next_slot < st->pos_slot || (end && stream->next_slot < ctx->num_pos_desc && ctx->pos_token[stream->next_slot].arg_count > 0)) {
+			*slot = stream->next_slot;
+			return &ctx->pos_token[stream->next_slot++];
+		}
+		if (end) {
+			if (!stream->finished) _vex_parse_end(ctx, st);
+			stream->finished = true;
+			return NULL;
 		}
-		else {
-			// Determine type
-			int type = VEX_ARG_TYPE_UNKNOWN;
-			for (const char* c = arg; *c != '\0'; ++c) {
-				if (!isdigit(*c)) {
-					if (*c == '.') {
-						type = VEX_ARG_TYPE_DUB;
-					}
-					else {
-						type = VEX_ARG_TYPE_STR;
-						break;
-					}
-				}
-				else if (type != VEX_ARG_TYPE_DUB) {
-					type = VEX_ARG_TYPE_INT;
-				}
-			}
 
-			bool group_with_last_token = false;
-			if (last_token >= 0) {
-				vex_arg_desc* desc = &ctx->arg_desc[last_desc];
-				vex_arg_token* token = &ctx->arg_token[last_token];
-				if (desc->max_count < 0 || token->arg_count < desc->max_count) group_with_last_token = true;
-			}
-			if (parse_options && group_with_last_token) {
-				// Add to last parsed option
-				vex_value value = { 0 };
-				vex_arg_token* token = &ctx->arg_token[last_token];
-				if (token->arg_type != type) {
-					_vex_set_status(ctx, VEX_STATUS_BAD_VALUE, "Unexpected value");
-					return false;
-				}
-				switch (type) {
-				case VEX_ARG_TYPE_INT: value.int_arg = atoi(arg); break;
-				case VEX_ARG_TYPE_DUB: value.dub_arg = atof(arg); break;
-				case VEX_ARG_TYPE_STR: value.str_arg = _vex_strdup(arg); break;
-				}
-				if (!_vec_token_add_value(ctx, token, value)) return false;
-			}
-			else {
-				// Add as a seperate token
-				vex_value value = { 0 };
-				vex_arg_token token = { 0 };
-				token.arg_type = type;
-				switch (type) {
-				case VEX_ARG_TYPE_INT: value.int_arg = atoi(arg); break;
-				case VEX_ARG_TYPE_DUB: value.dub_arg = atof(arg); break;
-				case VEX_ARG_TYPE_STR: value.str_arg = _vex_strdup(arg); break;
-				}
-				if (!_vec_token_add_value(ctx, &token, value)) return false;
-				if (!_vex_add_token(ctx, token)) return false;
-				last_token = -1;
-				last_desc = -1;
-			}
+		// Consume one more argument
+		char* arg = st->argv[stream->next_arg++];
+		if (!arg) continue;
+		_VEX_STAT_STEP_BEGIN(ctx);
+		bool parsed = _vex_parse_arg(ctx, st, arg, stream->next_arg - 1);
+		_VEX_STAT_STEP_END(ctx);
+		if (!parsed) {
+			stream->finished = true;
+			st->done = true;
+			stream->next_token = ctx->num_arg_token;
+			stream->next_slot = ctx->num_pos_desc;
+			return NULL;
 		}
 	}
-	return true;
 }
 
 int vex_token_count(vex_ctx* ctx) {
@@ -474,38 +3437,215 @@ vex_arg_token* vex_get_token(vex_ctx* ctx, int num) {
 	return &ctx->arg_token[num];
 }
 
+int vex_pos_count(vex_ctx* ctx) {
+	return ctx->num_pos_desc;
+}
+
+vex_arg_token* vex_get_pos(vex_ctx* ctx, int slot) {
+	if (slot < 0 || slot >= ctx->num_pos_desc) return NULL;
+	return &ctx->pos_token[slot];
+}
+
+char** vex_get_passthrough(vex_ctx* ctx, int* count) {
+	if (count) *count = ctx->pass_argc;
+	return ctx->pass_argv;
+}
+
+void vex_get_result(vex_ctx* ctx, vex_result* result) {
+	result->arg_token = ctx->arg_token;
+	result->num_arg_token = ctx->num_arg_token;
+	result->pos_token = ctx->pos_token;
+	result->num_pos_token = ctx->num_pos_desc;
+	result->pass_argv = ctx->pass_argv;
+	result->pass_argc = ctx->pass_argc;
+}
+
 bool vex_arg_found(vex_ctx* ctx, const char* name) {
 	if (!name) return false;
 	for (int i = 0; i < vex_token_count(ctx); ++i) {
 		vex_arg_token* token = vex_get_token(ctx, i);
 		if (strlen(name) == 1 && name[0] == token->short_name) return true;
-		else if (strlen(name) > 1 && strcmp(name, token->long_name) == 0) return true;
+		else if (strlen(name) > 1 && token->long_name && strcmp(name, token->long_name) == 0) return true;
 	}
 	return false;
 }
 
+#if defined(VEX_ENABLE_THREADS) && defined(_VEX_HAVE_ATOMICS)
+#define _VEX_PATH_THREADS
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
+#define _VEX_PATH_BATCH 64
+#define _VEX_PATH_DEFAULT_THREADS 4
+#define _VEX_PATH_MAX_THREADS 64
+
+typedef struct {
+	vex_path_result* results;
+	int count;
+	int next_batch;
+} _vex_path_job;
+
+static void _vex_check_path(vex_path_result* result) {
+	// One stat per path, and an access check only when it has to be readable
+	_vex_stat_info info;
+	if (_vex_stat(result->path, &info) != 0) {
+		result->kind = VEX_PATH_MISSING;
+		result->error = errno ? errno : ENOENT;
+		return;
+	}
+	result->kind = _VEX_IS_DIR(info.st_mode) ? VEX_PATH_DIR : _VEX_IS_REG(info.st_mode) ? VEX_PATH_FILE : VEX_PATH_OTHER;
+	result->error = 0;
+	if ((result->checks & VEX_DESC_PATH_FILE) && result->kind != VEX_PATH_FILE) result->error = (result->kind == VEX_PATH_DIR) ? EISDIR : EINVAL;
+	else if ((result->checks & VEX_DESC_PATH_DIR) && result->kind != VEX_PATH_DIR) result->error = ENOTDIR;
+	else if ((result->checks & VEX_DESC_PATH_READABLE) && !_vex_readable(result->path)) result->error = errno ? errno : EACCES;
+}
+
+static void _vex_path_worker(_vex_path_job* job) {
+	// Batches are handed out through a shared counter, so a slow file system only holds up the thread that hit it
+	for (;;) {
+		int first = _vex_next_int(&job->next_batch) * _VEX_PATH_BATCH;
+		if (first >= job->count) return;
+		int last = (job->count - first > _VEX_PATH_BATCH) ? first + _VEX_PATH_BATCH : job->count;
+		for (int i = first; i < last; ++i) _vex_check_path(&job->results[i]);
+	}
+}
+
+#ifdef _VEX_PATH_THREADS
+#if defined(_WIN32)
+static DWORD WINAPI _vex_path_thread(LPVOID arg) {
+	_vex_path_worker(CPPCAST(_vex_path_job*)arg);
+	return 0;
+}
+#else
+static void* _vex_path_thread(void* arg) {
+	_vex_path_worker(CPPCAST(_vex_path_job*)arg);
+	return NULL;
+}
+#endif
+#endif
+
+bool vex_check_paths(vex_ctx* ctx, int num_threads) {
+	_vex_path_job job;
+	job.results = ctx->path_results;
+	job.count = ctx->num_path_results;
+	job.next_batch = 0;
+
+	// No more threads than batches, and the calling thread takes part
+	int num_batches = (job.count + _VEX_PATH_BATCH - 1) / _VEX_PATH_BATCH;
+	if (num_threads <= 0) num_threads = _VEX_PATH_DEFAULT_THREADS;
+	if (num_threads > num_batches) num_threads = num_batches;
+	if (num_threads > _VEX_PATH_MAX_THREADS) num_threads = _VEX_PATH_MAX_THREADS;
+#ifdef _VEX_PATH_THREADS
+	// A thread that can't be started just leaves more batches for the others
+#if defined(_WIN32)
+	HANDLE threads[_VEX_PATH_MAX_THREADS];
+	int started = 0;
+	for (int t = 1; t < num_threads; ++t) {
+		threads[started] = CreateThread(NULL, 0, _vex_path_thread, &job, 0, NULL);
+		if (!threads[started]) break;
+		started++;
+	}
+	_vex_path_worker(&job);
+	for (int t = 0; t < started; ++t) {
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+	}
+#else
+	pthread_t threads[_VEX_PATH_MAX_THREADS];
+	int started = 0;
+	for (int t = 1; t < num_threads; ++t) {
+		if (pthread_create(&threads[started], NULL, _vex_path_thread, &job) != 0) break;
+		started++;
+	}
+	_vex_path_worker(&job);
+	for (int t = 0; t < started; ++t) pthread_join(threads[t], NULL);
+#endif
+#else
+	_vex_path_worker(&job);
+#endif
+
+	// Every result is kept, the status describes the first failure in argument order
+	for (int i = 0; i < job.count; ++i) {
+		const vex_path_result* result = &job.results[i];
+		if (!result->error) continue;
+		char short_name[3] = { '-', '\0', '\0' };
+		const char* name = short_name;
+		if (result->positional) name = ctx->pos_desc[result->token].name;
+		else if (ctx->arg_token[result->token].long_name) name = ctx->arg_token[result->token].long_name;
+		else short_name[1] = ctx->arg_token[result->token].short_name;
+		_vex_set_status(ctx, VEX_STATUS_BAD_PATH, "Invalid path for %s: %s (%s)", name, result->path, strerror(result->error));
+		return false;
+	}
+	return true;
+}
+
+const vex_path_result* vex_get_path_results(vex_ctx* ctx, int* count) {
+	*count = ctx->num_path_results;
+	return ctx->path_results;
+}
+
 void vex_free(vex_ctx* ctx) {
 	if (ctx->arg_desc) {
 		for (int i = 0; i < ctx->num_arg_desc; ++i) {
 			assert(ctx->arg_desc);
 			vex_arg_desc desc = ctx->arg_desc[i];
 			VEX_FREE(desc.long_name);
+			VEX_FREE(desc.description);
 		}
 		VEX_FREE(ctx->arg_desc);
 	}
-	if (ctx->arg_token) {
-		for (int i = 0; i < ctx->num_arg_token; ++i) {
-			assert(ctx->arg_token);
-			vex_arg_token token = ctx->arg_token[i];
-			VEX_FREE(token.long_name);
-			if (token.arg_type == VEX_ARG_TYPE_STR) {
-				for (int j = 0; j < token.arg_count; ++j) {
-					VEX_FREE(token.arg[j].str_arg);
-				}
-			}
-			VEX_FREE(token.arg);
+	if (ctx->arg_hot) VEX_FREE(ctx->arg_hot);
+	if (ctx->arg_index) VEX_FREE(ctx->arg_index);
+	for (int g = 0; g < ctx->num_groups; ++g) {
+		if (ctx->groups[g].members) VEX_FREE(ctx->groups[g].members);
+		if (ctx->groups[g].index) VEX_FREE(ctx->groups[g].index);
+		if (ctx->groups[g].prefix) VEX_FREE(ctx->groups[g].prefix);
+	}
+	if (ctx->groups) VEX_FREE(ctx->groups);
+	if (ctx->group_index) VEX_FREE(ctx->group_index);
+	if (ctx->free_desc) VEX_FREE(ctx->free_desc);
+	ctx->groups = NULL;
+	ctx->num_groups = 0;
+	ctx->capacity_groups = 0;
+	ctx->group_index = NULL;
+	ctx->capacity_group_index = 0;
+	ctx->free_desc = NULL;
+	ctx->num_free_desc = 0;
+	ctx->arg_hot = NULL;
+	ctx->arg_index = NULL;
+	ctx->capacity_arg_index = 0;
+	for (int i = 0; i < ctx->capacity_arg_token; ++i) {
+		_vex_free_token_values(&ctx->arg_token[i]);
+	}
+	if (ctx->arg_token) VEX_FREE(ctx->arg_token);
+	ctx->arg_token = NULL;
+	ctx->num_arg_token = 0;
+	ctx->capacity_arg_token = 0;
+	if (ctx->pass_index) VEX_FREE(ctx->pass_index);
+	ctx->pass_index = NULL;
+	ctx->capacity_pass_index = 0;
+	if (ctx->path_results) VEX_FREE(ctx->path_results);
+	ctx->path_results = NULL;
+	ctx->num_path_results = 0;
+	ctx->capacity_path_results = 0;
+	_vex_dir_cache_free(ctx);
+	_vex_arena_free(ctx);
+	vex_clear_interned(ctx);
+	if (ctx->pos_desc) {
+		for (int i = 0; i < ctx->num_pos_desc; ++i) {
+			VEX_FREE(ctx->pos_desc[i].name);
+			VEX_FREE(ctx->pos_desc[i].description);
+			_vex_free_token_values(&ctx->pos_token[i]);
 		}
-		VEX_FREE(ctx->arg_token);
+		VEX_FREE(ctx->pos_desc);
+		VEX_FREE(ctx->pos_token);
 	}
 	if (ctx->status_msg) VEX_FREE(ctx->status_msg);
 	if (ctx->help_msg) VEX_FREE(ctx->help_msg);
@@ -514,6 +3654,169 @@ void vex_free(vex_ctx* ctx) {
 	VEX_FREE(ctx->description);
 	VEX_FREE(ctx->version);
 	VEX_FREE(ctx->name);
+	ctx->usage = NULL;
+	ctx->usage_shard = NULL;
+}
+
+bool vex_get_stats(const vex_ctx* ctx, vex_stats* stats) {
+	// Statistics are only gathered when compiled in
+#ifdef VEX_ENABLE_STATS
+	*stats = ctx->stats;
+	return true;
+#else
+	(void)ctx;
+	memset(stats, 0, sizeof(*stats));
+	return false;
+#endif
+}
+
+void vex_reset_stats(vex_ctx* ctx) {
+#ifdef VEX_ENABLE_STATS
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+#else
+	(void)ctx;
+#endif
+}
+
+vex_memory vex_memory_usage(const vex_ctx* ctx) {
+	vex_memory usage;
+	memset(&usage, 0, sizeof(usage));
+
+	// Descriptors and the strings copied from them
+	usage.descriptors += ctx->num_arg_desc * (sizeof(vex_arg_desc) + sizeof(vex_arg_hot));
+	usage.descriptors += ctx->capacity_arg_index * sizeof(int);
+	usage.descriptors += ctx->num_pos_desc * (sizeof(vex_pos_desc) + sizeof(vex_arg_token));
+	usage.slack += (ctx->capacity_arg_desc - ctx->num_arg_desc) * (sizeof(vex_arg_desc) + sizeof(vex_arg_hot));
+	usage.slack += (ctx->capacity_pos_desc - ctx->num_pos_desc) * (sizeof(vex_pos_desc) + sizeof(vex_arg_token));
+	usage.descriptors += ctx->capacity_groups * sizeof(vex_group) + ctx->capacity_group_index * sizeof(int);
+	if (ctx->free_desc) usage.descriptors += ctx->capacity_arg_desc * sizeof(int);
+	for (int g = 0; g < ctx->num_groups; ++g) {
+		const vex_group* group = &ctx->groups[g];
+		if (!group->prefix) continue;
+		usage.descriptors += ((group->num_members > 0) ? group->num_members : 1) * sizeof(int) + group->capacity_index * sizeof(int);
+		usage.schema_strings += _vex_str_size(group->prefix);
+	}
+	usage.schema_strings += _vex_str_size(ctx->name) + _vex_str_size(ctx->description) + _vex_str_size(ctx->version);
+	for (int i = 0; i < ctx->num_arg_desc; ++i) {
+		usage.schema_strings += _vex_str_size(ctx->arg_desc[i].long_name) + _vex_str_size(ctx->arg_desc[i].description);
+	}
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		usage.schema_strings += _vex_str_size(ctx->pos_desc[i].name) + _vex_str_size(ctx->pos_desc[i].description);
+	}
+
+	// Cached messages
+	usage.help_cache += _vex_str_size(ctx->help_msg);
+	if (ctx->status_msg) usage.help_cache += _VEX_STATUS_MSG_LEN;
+
+	// Parse results
+	usage.tokens += ctx->num_arg_token * sizeof(vex_arg_token);
+	usage.slack += (ctx->capacity_arg_token - ctx->num_arg_token) * sizeof(vex_arg_token);
+	_vex_token_memory(ctx->arg_token, ctx->num_arg_token, ctx->capacity_arg_token, &usage);
+	_vex_token_memory(ctx->pos_token, ctx->num_pos_desc, ctx->num_pos_desc, &usage);
+	usage.values += ctx->num_path_results * sizeof(vex_path_result);
+	usage.slack += (ctx->capacity_path_results - ctx->num_path_results) * sizeof(vex_path_result);
+
+	// Forwarded positions are only needed while a parse runs
+	usage.slack += ctx->capacity_pass_index * sizeof(int);
+	usage.values += ctx->capacity_dir_cache * sizeof(vex_dir_listing);
+	for (int i = 0; i < ctx->capacity_dir_cache; ++i) {
+		const vex_dir_listing* listing = &ctx->dir_cache[i];
+		if (!listing->path) continue;
+		usage.values += _vex_str_size(listing->path) + listing->num_names * sizeof(char*) + listing->capacity_chars;
+	}
+
+	// Chunks after the current one only hold strings from earlier parses
+	bool current = ctx->arena_cur != NULL;
+	for (const vex_arena_chunk* chunk = ctx->arena; chunk; chunk = chunk->next) {
+		size_t used = current ? chunk->used : 0;
+		usage.string_values += used;
+		usage.slack += sizeof(vex_arena_chunk) + chunk->size - used;
+		if (chunk == ctx->arena_cur) current = false;
+	}
+
+	// Interned strings outlive the parse that added them
+	usage.interned += ctx->capacity_intern * sizeof(vex_intern_entry);
+	for (const vex_arena_chunk* chunk = ctx->intern_pool; chunk; chunk = chunk->next) {
+		usage.interned += chunk->used;
+		usage.slack += sizeof(vex_arena_chunk) + chunk->size - chunk->used;
+	}
+
+	usage.total = usage.descriptors + usage.schema_strings + usage.help_cache + usage.tokens + usage.values + usage.string_values + usage.interned + usage.slack;
+	return usage;
+}
+
+void vex_clear_interned(vex_ctx* ctx) {
+	while (ctx->intern_pool) {
+		vex_arena_chunk* next = ctx->intern_pool->next;
+		VEX_FREE(ctx->intern_pool);
+		ctx->intern_pool = next;
+	}
+	if (ctx->intern) VEX_FREE(ctx->intern);
+	ctx->intern = NULL;
+	ctx->num_intern = 0;
+	ctx->capacity_intern = 0;
+}
+
+#define _VEX_USAGE_DEFAULT_SHARDS 16
+#define _VEX_CACHE_LINE 64
+
+bool vex_usage_init(vex_usage* usage, const vex_ctx* ctx, int num_shards) {
+	// One row of counters per shard, each starting on its own cache line so parsers don't contend
+	memset(usage, 0, sizeof(*usage));
+	if (num_shards <= 0) num_shards = _VEX_USAGE_DEFAULT_SHARDS;
+	int per_line = _VEX_CACHE_LINE / (int)sizeof(uint64_t);
+	int stride = (ctx->num_arg_desc + per_line - 1) / per_line * per_line;
+	if (stride == 0) stride = per_line;
+	size_t bytes = (size_t)stride * (size_t)num_shards * sizeof(uint64_t);
+	usage->block = VEX_MALLOC(bytes + _VEX_CACHE_LINE);
+	if (!usage->block) return false;
+	uintptr_t aligned = ((uintptr_t)usage->block + _VEX_CACHE_LINE - 1) & ~(uintptr_t)(_VEX_CACHE_LINE - 1);
+	usage->counters = CPPCAST(uint64_t*)(void*)aligned;
+	memset(usage->counters, 0, bytes);
+	usage->num_counters = ctx->num_arg_desc;
+	usage->num_shards = num_shards;
+	usage->stride = stride;
+	return true;
+}
+
+void vex_usage_attach(vex_ctx* ctx, vex_usage* usage) {
+	// Contexts take shards round-robin, a NULL table detaches; the turn counter is unsigned so it stays in range when it wraps
+	ctx->usage = usage;
+	ctx->usage_shard = NULL;
+	if (!usage) return;
+	unsigned int shard = _vex_next_uint(&usage->next_shard) % (unsigned int)usage->num_shards;
+	ctx->usage_shard = &usage->counters[(size_t)shard * (size_t)usage->stride];
+}
+
+void vex_usage_snapshot(const vex_usage* usage, uint64_t* counts) {
+	// Counters keep running while this sums them, so each total is only exact at some point during the call
+	for (int d = 0; d < usage->num_counters; ++d) {
+		counts[d] = _vex_usage_total(usage, d);
+	}
+}
+
+bool vex_usage_export(const vex_usage* usage, const vex_ctx* ctx, vex_json_writer* writer) {
+	// Object keyed by long name, or short name for options without one
+	_vex_json_put(writer, "{", 1);
+	bool first = true;
+	for (int d = 0; d < usage->num_counters && d < ctx->num_arg_desc; ++d) {
+		if (ctx->arg_hot[d].flags & _VEX_HOT_REMOVED) continue;
+		uint64_t total = _vex_usage_total(usage, d);
+		if (!first) _vex_json_put(writer, ",", 1);
+		first = false;
+		char short_name[2] = { ctx->arg_desc[d].short_name, '\0' };
+		_vex_json_str(writer, ctx->arg_desc[d].long_name ? ctx->arg_desc[d].long_name : short_name);
+		char buffer[32];
+		int len = snprintf(buffer, sizeof(buffer), ":%llu", (unsigned long long)total);
+		_vex_json_put(writer, buffer, (size_t)len);
+	}
+	_vex_json_put(writer, "}", 1);
+	return !writer->error;
+}
+
+void vex_usage_free(vex_usage* usage) {
+	if (usage->block) VEX_FREE(usage->block);
+	memset(usage, 0, sizeof(*usage));
 }
 
 const char* vex_get_version(vex_ctx* ctx) {
@@ -521,7 +3824,8 @@ const char* vex_get_version(vex_ctx* ctx) {
 }
 
 const char* vex_get_help(vex_ctx* ctx) {
-	if (ctx->help_msg) return ctx->help_msg;
+	char* help_msg = _vex_load_ptr(&ctx->help_msg);
+	if (help_msg) return help_msg;
 
 	// Initial allocation
 	size_t buffer_len = strlen(ctx->name) + 32;
@@ -533,13 +3837,20 @@ const char* vex_get_help(vex_ctx* ctx) {
 		max_arg_len = (arg_len > max_arg_len) ? arg_len : max_arg_len;
 		if (ctx->arg_desc[i].description) buffer_len += strlen(ctx->arg_desc[i].description);
 	}
-	buffer_len += (2 * ctx->num_arg_desc * max_arg_len) + 1;
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		size_t arg_len = 16 + strlen(ctx->pos_desc[i].name);
+		max_arg_len = (arg_len > max_arg_len) ? arg_len : max_arg_len;
+		if (ctx->pos_desc[i].description) buffer_len += strlen(ctx->pos_desc[i].description);
+	}
+	if (ctx->num_pos_desc > 0) buffer_len += 32;
+	buffer_len += (2 * (ctx->num_arg_desc + ctx->num_pos_desc) * max_arg_len) + 1;
 	char* buffer = CPPCAST(char*)VEX_MALLOC(buffer_len);
 	if (!buffer) return NULL;
 	snprintf(buffer, buffer_len, "Usage: %s", ctx->name);
 
 	// Add args to usage
 	for (int i = 0; i < ctx->num_arg_desc; ++i) {
+		if (ctx->arg_hot[i].flags & _VEX_HOT_REMOVED) continue;
 		vex_arg_desc* desc = &ctx->arg_desc[i];
 		strcat_s(buffer, buffer_len, " [");
 		if (desc->short_name != '\0') {
@@ -554,6 +3865,12 @@ const char* vex_get_help(vex_ctx* ctx) {
 		strcat_s(buffer, buffer_len, "] ");
 		if (desc->arg_type != VEX_ARG_TYPE_FLAG && desc->max_count != 0) strcat_s(buffer, buffer_len, "... ");
 	}
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		vex_pos_desc* desc = &ctx->pos_desc[i];
+		strcat_s(buffer, buffer_len, "<");
+		strcat_s(buffer, buffer_len, desc->name);
+		strcat_s(buffer, buffer_len, (desc->max_count != 1) ? ">... " : "> ");
+	}
 	strcat_s(buffer, buffer_len, "\n\n");
 
 	// Add description
@@ -567,6 +3884,7 @@ const char* vex_get_help(vex_ctx* ctx) {
 	strcat_s(buffer, buffer_len, "Arguments:\n");
 	for (int i = 0; i < ctx->num_arg_desc; ++i) {
 		// Argument name
+		if (ctx->arg_hot[i].flags & _VEX_HOT_REMOVED) continue;
 		size_t buffer_len_curr = strlen(buffer);
 		size_t arg_len = 1;
 		vex_arg_desc* desc = &ctx->arg_desc[i];
@@ -597,8 +3915,475 @@ const char* vex_get_help(vex_ctx* ctx) {
 		if (desc->description) strcat_s(buffer, buffer_len, desc->description);
 		strcat_s(buffer, buffer_len, "\n");
 	}
-	ctx->help_msg = buffer;
-	return ctx->help_msg;
+
+	// Add positional arguments
+	if (ctx->num_pos_desc > 0) {
+		strcat_s(buffer, buffer_len, "\nPositional arguments:\n");
+		for (int i = 0; i < ctx->num_pos_desc; ++i) {
+			// Slot name
+			size_t buffer_len_curr = strlen(buffer);
+			vex_pos_desc* desc = &ctx->pos_desc[i];
+			strcat_s(buffer, buffer_len, " <");
+			strcat_s(buffer, buffer_len, desc->name);
+			strcat_s(buffer, buffer_len, ">");
+			size_t arg_len = 3 + strlen(desc->name);
+
+			// Padding
+			while (arg_len < max_arg_len + 1) {
+				buffer[buffer_len_curr + arg_len] = ' ';
+				arg_len++;
+				buffer[buffer_len_curr + arg_len] = '\0';
+			}
+
+			// Description
+			if (desc->description) strcat_s(buffer, buffer_len, desc->description);
+			strcat_s(buffer, buffer_len, "\n");
+		}
+	}
+
+	// Several threads may get here at once; the first to publish wins and the rest discard their copy
+	if (!_vex_publish_ptr(&ctx->help_msg, buffer)) {
+		VEX_FREE(buffer);
+		return _vex_load_ptr(&ctx->help_msg);
+	}
+	_VEX_NOTE_ALLOC(ctx, buffer, buffer_len);
+	return buffer;
+}
+
+char** vex_build_argv(vex_ctx* ctx, const char* argv0, const vex_arg_token* tokens, int num_tokens, int* argc) {
+	// Sizing pass
+	_vex_render_buf out = { 0 };
+	if (!_vex_render(ctx, argv0, tokens, num_tokens, &out)) return NULL;
+
+	// Pointer table and strings share a single exact-size allocation
+	size_t table_len = (out.argc + 1) * sizeof(char*);
+	char* block = CPPCAST(char*)VEX_MALLOC(table_len + out.len);
+	if (!block) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+		return NULL;
+	}
+	memset(&out, 0, sizeof(out));
+	out.argv = CPPCAST(char**)(void*)block;
+	out.buffer = block + table_len;
+	_vex_render(ctx, argv0, tokens, num_tokens, &out);
+	out.argv[out.argc] = NULL;
+	if (argc) *argc = out.argc;
+	return out.argv;
+}
+
+char* vex_build_cmdline(vex_ctx* ctx, const char* argv0, const vex_arg_token* tokens, int num_tokens) {
+	// Sizing pass
+	_vex_render_buf out = { 0 };
+	out.quote = true;
+	if (!_vex_render(ctx, argv0, tokens, num_tokens, &out)) return NULL;
+
+	char* buffer = CPPCAST(char*)VEX_MALLOC(out.len + 1);
+	if (!buffer) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+		return NULL;
+	}
+	memset(&out, 0, sizeof(out));
+	out.quote = true;
+	out.buffer = buffer;
+	_vex_render(ctx, argv0, tokens, num_tokens, &out);
+	buffer[out.len] = '\0';
+	return buffer;
+}
+
+void vex_free_buffer(void* buffer) {
+	if (buffer) VEX_FREE(buffer);
+}
+
+static void _vex_hash_str(vex_hash128* hash, char tag, const char* str) {
+	_vex_hash_tag(hash, tag, str ? 1 : 0);
+	if (str) _vex_hash_bytes(hash, str, strlen(str));
+}
+
+static vex_hash128 _vex_schema_hash(vex_ctx* ctx) {
+	// Everything that changes what a command line means: each descriptor, the flags and the limits. Recomputed only
+	// when the schema changes, since large schemas would otherwise cost more than parsing
+	if (ctx->schema_hash_version == ctx->schema_version) return ctx->schema_hash;
+	vex_hash128 h = { 0x9e3779b97f4a7c15ULL, 0x6a09e667f3bcc908ULL };
+	_vex_hash_tag(&h, 'F', ctx->flags);
+	for (int d = 0; d < ctx->num_arg_desc; ++d) {
+		const vex_arg_desc* desc = &ctx->arg_desc[d];
+		_vex_hash_tag(&h, 'D', desc->short_name);
+		_vex_hash_str(&h, 'N', desc->long_name);
+		_vex_hash_tag(&h, 'T', desc->arg_type);
+		_vex_hash_tag(&h, 'C', desc->max_count);
+		_vex_hash_tag(&h, 'F', ctx->arg_hot[d].flags);
+	}
+	for (int i = 0; i < ctx->num_pos_desc; ++i) {
+		const vex_pos_desc* desc = &ctx->pos_desc[i];
+		_vex_hash_str(&h, 'P', desc->name);
+		_vex_hash_tag(&h, 'T', desc->arg_type);
+		_vex_hash_tag(&h, 'C', desc->max_count);
+		_vex_hash_tag(&h, 'F', desc->flags);
+	}
+	_vex_hash_tag(&h, 'L', ctx->limits.max_args);
+	_vex_hash_tag(&h, 'L', ctx->limits.max_values);
+	_vex_hash_mix(&h, (uint64_t)ctx->limits.max_arg_len);
+	_vex_hash_mix(&h, (uint64_t)ctx->limits.max_total_bytes);
+	ctx->schema_hash = h;
+	ctx->schema_hash_version = ctx->schema_version;
+	return h;
+}
+
+static bool _vex_hash_argv(vex_ctx* ctx, int argc, char** argv, vex_hash128* hash, bool* uses_fs) {
+	// Run the parser without converting or storing anything, hashing what it would have stored
+	vex_hash128 h = _vex_schema_hash(ctx);
+	_vex_parse_state state = _vex_parse_begin(argc, argv, 1);
+	state.hash = &h;
+	if (!_vex_parse_run(ctx, &state)) return false;
+	_vex_hash_final(&h);
+	*hash = h;
+	if (uses_fs) *uses_fs = state.uses_fs;
+	return true;
+}
+
+bool vex_canonical_hash(vex_ctx* ctx, int argc, char** argv, vex_hash128* hash) {
+	return _vex_hash_argv(ctx, argc, argv, hash, NULL);
+}
+
+bool vex_cache_init(vex_cache* cache, int capacity) {
+	if (!cache || capacity <= 0) return false;
+	memset(cache, 0, sizeof(*cache));
+	cache->num_buckets = 1;
+	while (cache->num_buckets < capacity) cache->num_buckets *= 2;
+	cache->entries = CPPCAST(vex_cache_entry*)VEX_MALLOC(capacity * sizeof(*cache->entries));
+	cache->buckets = CPPCAST(int*)VEX_MALLOC(cache->num_buckets * sizeof(*cache->buckets));
+	if (!cache->entries || !cache->buckets) {
+		vex_cache_free(cache);
+		return false;
+	}
+	cache->capacity = capacity;
+	cache->head = -1;
+	cache->tail = -1;
+	for (int i = 0; i < cache->num_buckets; ++i) cache->buckets[i] = -1;
+	return true;
+}
+
+const vex_result* vex_cache_parse(vex_cache* cache, vex_ctx* ctx, int argc, char** argv) {
+	// Repeat command lines skip parsing altogether
+	vex_hash128 hash;
+	bool uses_fs = false;
+	if (_vex_hash_argv(ctx, argc, argv, &hash, &uses_fs) && !uses_fs) {
+		int e = _vex_cache_find(cache, hash);
+		if (e >= 0) {
+			_vex_cache_unlink(cache, e);
+			_vex_cache_push_front(cache, e);
+			return cache->entries[e].result;
+		}
+	}
+
+	// Anything the hash pass rejects is rejected by the real parse too
+	if (cache->uncached) VEX_FREE(cache->uncached);
+	cache->uncached = NULL;
+	if (!vex_parse(ctx, argc, argv)) return NULL;
+	vex_result* result = _vex_snapshot(ctx);
+	if (!result) {
+		_vex_set_status(ctx, VEX_STATUS_BAD_ALLOC, NULL);
+		return NULL;
+	}
+
+	// Glob matches and path checks depend on the file system, so those results are only kept until the next call
+	if (uses_fs) {
+		cache->uncached = result;
+		return result;
+	}
+
+	// Insert, evicting the least recently used entry when full
+	int e = (cache->num_entries < cache->capacity) ? cache->num_entries++ : _vex_cache_evict(cache);
+	vex_cache_entry* entry = &cache->entries[e];
+	int* bucket = &cache->buckets[hash.lo & (cache->num_buckets - 1)];
+	entry->hash = hash;
+	entry->result = result;
+	entry->chain = *bucket;
+	*bucket = e;
+	_vex_cache_push_front(cache, e);
+	return result;
+}
+
+void vex_cache_clear(vex_cache* cache) {
+	for (int i = 0; i < cache->num_entries; ++i) {
+		VEX_FREE(cache->entries[i].result);
+	}
+	if (cache->uncached) VEX_FREE(cache->uncached);
+	cache->uncached = NULL;
+	for (int i = 0; i < cache->num_buckets && cache->buckets; ++i) cache->buckets[i] = -1;
+	cache->num_entries = 0;
+	cache->head = -1;
+	cache->tail = -1;
+}
+
+void vex_cache_free(vex_cache* cache) {
+	if (cache->entries) vex_cache_clear(cache);
+	VEX_FREE(cache->entries);
+	VEX_FREE(cache->buckets);
+	memset(cache, 0, sizeof(*cache));
+}
+
+size_t vex_result_pack(const vex_result* result, void* buffer, size_t size) {
+	// Sizing pass
+	size_t num_values = 0;
+	size_t num_chars = _vex_snapshot_size(result->arg_token, result->num_arg_token, &num_values);
+	num_chars += _vex_snapshot_size(result->pos_token, result->num_pos_token, &num_values);
+	for (int i = 0; i < result->pass_argc; ++i) num_chars += strlen(result->pass_argv[i]) + 1;
+
+	// Fixed-size sections first, strings last; the final byte is always NUL so no string can run off the end
+	int num_tokens = result->num_arg_token + result->num_pos_token;
+	size_t off_tokens = _vex_align(sizeof(vex_packed_result));
+	size_t off_values = off_tokens + _vex_align(num_tokens * sizeof(vex_packed_token));
+	size_t off_pass = off_values + num_values * sizeof(vex_packed_value);
+	size_t off_chars = off_pass + result->pass_argc * sizeof(uint32_t);
+	size_t total = _vex_align(off_chars + num_chars + 1);
+	if ((uint64_t)total > UINT32_MAX) return 0;
+	if (!buffer || size < total) return total;
+
+	// Writing pass
+	char* base = CPPCAST(char*)buffer;
+	memset(base, 0, total);
+	vex_packed_result* packed = CPPCAST(vex_packed_result*)buffer;
+	packed->magic = VEX_PACK_MAGIC;
+	packed->size = (uint32_t)total;
+	packed->num_arg_token = result->num_arg_token;
+	packed->num_pos_token = result->num_pos_token;
+	packed->pass_argc = result->pass_argc;
+	packed->tokens = (uint32_t)off_tokens;
+	packed->pass_argv = (uint32_t)off_pass;
+	vex_packed_token* tokens = CPPCAST(vex_packed_token*)(void*)&base[off_tokens];
+	_vex_pack_tokens(base, result->arg_token, result->num_arg_token, tokens, &off_values, &off_chars);
+	_vex_pack_tokens(base, result->pos_token, result->num_pos_token, tokens + result->num_arg_token, &off_values, &off_chars);
+	uint32_t* pass = CPPCAST(uint32_t*)(void*)&base[off_pass];
+	for (int i = 0; i < result->pass_argc; ++i) pass[i] = _vex_pack_str(base, &off_chars, result->pass_argv[i]);
+	return total;
+}
+
+const vex_packed_result* vex_packed_open(const void* buffer, size_t size) {
+	// Check the header
+	const vex_packed_result* packed = CPPCAST(const vex_packed_result*)buffer;
+	if (!buffer || ((uintptr_t)buffer & 7) != 0 || size < sizeof(*packed)) return NULL;
+	if (packed->magic != VEX_PACK_MAGIC || packed->size > size || packed->size < sizeof(*packed)) return NULL;
+	if (packed->num_arg_token < 0 || packed->num_pos_token < 0 || packed->pass_argc < 0) return NULL;
+	const char* base = CPPCAST(const char*)buffer;
+	if (base[packed->size - 1] != '\0') return NULL;
+
+	// Check every offset once, so reads after this never leave the buffer
+	int num_tokens = packed->num_arg_token + packed->num_pos_token;
+	if ((packed->tokens & 7) != 0 || !_vex_packed_range(packed, packed->tokens, (uint64_t)num_tokens * sizeof(vex_packed_token))) return NULL;
+	const vex_packed_token* tokens = CPPCAST(const vex_packed_token*)(const void*)&base[packed->tokens];
+	for (int i = 0; i < num_tokens; ++i) {
+		const vex_packed_token* token = &tokens[i];
+		if (token->long_name >= packed->size || token->arg_count < 0 || (token->arg & 7) != 0) return NULL;
+		if (!_vex_packed_range(packed, token->arg, (uint64_t)token->arg_count * sizeof(vex_packed_value))) return NULL;
+		if (token->arg_type != VEX_ARG_TYPE_STR) continue;
+		const vex_packed_value* values = CPPCAST(const vex_packed_value*)(const void*)&base[token->arg];
+		for (int j = 0; j < token->arg_count; ++j) {
+			if (values[j].str_arg >= packed->size) return NULL;
+		}
+	}
+	if ((packed->pass_argv & 3) != 0 || !_vex_packed_range(packed, packed->pass_argv, (uint64_t)packed->pass_argc * sizeof(uint32_t))) return NULL;
+	const uint32_t* pass = CPPCAST(const uint32_t*)(const void*)&base[packed->pass_argv];
+	for (int i = 0; i < packed->pass_argc; ++i) {
+		if (pass[i] >= packed->size) return NULL;
+	}
+	return packed;
+}
+
+const vex_packed_token* vex_packed_get_token(const vex_packed_result* packed, int num) {
+	if (num < 0 || num >= packed->num_arg_token) return NULL;
+	const vex_packed_token* tokens = CPPCAST(const vex_packed_token*)(const void*)((const char*)packed + packed->tokens);
+	return &tokens[num];
+}
+
+const vex_packed_token* vex_packed_get_pos(const vex_packed_result* packed, int slot) {
+	if (slot < 0 || slot >= packed->num_pos_token) return NULL;
+	const vex_packed_token* tokens = CPPCAST(const vex_packed_token*)(const void*)((const char*)packed + packed->tokens);
+	return &tokens[packed->num_arg_token + slot];
+}
+
+const vex_packed_value* vex_packed_get_values(const vex_packed_result* packed, const vex_packed_token* token) {
+	return CPPCAST(const vex_packed_value*)(const void*)((const char*)packed + token->arg);
+}
+
+const char* vex_packed_get_str(const vex_packed_result* packed, uint32_t offset) {
+	if (offset == 0 || offset >= packed->size) return NULL;
+	return (const char*)packed + offset;
+}
+
+const char* vex_packed_get_passthrough(const vex_packed_result* packed, int num) {
+	if (num < 0 || num >= packed->pass_argc) return NULL;
+	const uint32_t* pass = CPPCAST(const uint32_t*)(const void*)((const char*)packed + packed->pass_argv);
+	return vex_packed_get_str(packed, pass[num]);
+}
+
+bool vex_packed_arg_found(const vex_packed_result* packed, const char* name) {
+	if (!name) return false;
+	size_t len = strlen(name);
+	for (int i = 0; i < packed->num_arg_token; ++i) {
+		const vex_packed_token* token = vex_packed_get_token(packed, i);
+		const char* long_name = vex_packed_get_str(packed, token->long_name);
+		if (len == 1 && name[0] == token->short_name) return true;
+		else if (len > 1 && long_name && strcmp(name, long_name) == 0) return true;
+	}
+	return false;
+}
+
+void vex_json_init_buffer(vex_json_writer* writer, char* buffer, size_t capacity) {
+	memset(writer, 0, sizeof(*writer));
+	writer->buffer = buffer;
+	writer->capacity = buffer ? capacity : 0;
+	writer->fd = -1;
+}
+
+void vex_json_init_fd(vex_json_writer* writer, int fd, char* buffer, size_t capacity) {
+	vex_json_init_buffer(writer, buffer, capacity);
+	writer->fd = fd;
+}
+
+bool vex_json_write(vex_json_writer* writer, const vex_result* result, int flags) {
+	_vex_json_result(writer, result);
+	if (flags & VEX_JSON_NDJSON) _vex_json_put(writer, "\n", 1);
+	return !writer->error;
+}
+
+bool vex_json_write_batch(vex_json_writer* writer, const vex_result* const* results, int count, int flags) {
+	// NDJSON emits one independent line per result, plain JSON wraps them in an array
+	bool ndjson = (flags & VEX_JSON_NDJSON) != 0;
+	if (!ndjson) _vex_json_put(writer, "[", 1);
+	for (int i = 0; i < count; ++i) {
+		if (!ndjson && i > 0) _vex_json_put(writer, ",", 1);
+		_vex_json_result(writer, results[i]);
+		if (ndjson) _vex_json_put(writer, "\n", 1);
+	}
+	if (!ndjson) _vex_json_put(writer, "]", 1);
+	return !writer->error;
+}
+
+bool vex_json_flush(vex_json_writer* writer) {
+	if (writer->fd < 0 || writer->error) return !writer->error;
+	size_t done = 0;
+	while (done < writer->len) {
+		long written = (long)_vex_write_fd(writer->fd, &writer->buffer[done], writer->len - done);
+		if (written <= 0) {
+			writer->error = true;
+			return false;
+		}
+		done += (size_t)written;
+	}
+	writer->len = 0;
+	return true;
+}
+
+void vex_getopt_init(vex_getopt* state) {
+	memset(state, 0, sizeof(*state));
+	state->optind = 1;
+	state->opterr = 1;
+	state->optopt = '?';
+}
+
+int vex_getopt_long(vex_getopt* state, int argc, char* const argv[], const char* optstring, const vex_option* longopts, int* longindex) {
+	// Non-options are permuted to the end like glibc does, so argv is written to despite the const
+	char** args = (char**)argv;
+	state->optarg = NULL;
+	if (argc < 1 || !_vex_getopt_tables(state, optstring, longopts)) return -1;
+
+	// Setting optind to zero restarts the scan
+	if (state->optind == 0 || !state->initialized) {
+		if (state->optind == 0) state->optind = 1;
+		state->first_nonopt = state->optind;
+		state->last_nonopt = state->optind;
+		state->nextchar = NULL;
+		state->initialized = true;
+	}
+
+	if (!state->nextchar || *state->nextchar == '\0') {
+		// Start on the next argument
+		if (state->last_nonopt > state->optind) state->last_nonopt = state->optind;
+		if (state->first_nonopt > state->optind) state->first_nonopt = state->optind;
+		if (state->ordering == _VEX_GETOPT_PERMUTE) {
+			if (state->first_nonopt != state->last_nonopt && state->last_nonopt != state->optind) _vex_getopt_exchange(state, args);
+			else if (state->last_nonopt != state->optind) state->first_nonopt = state->optind;
+			while (state->optind < argc && _VEX_GETOPT_NONOPTION(args[state->optind])) state->optind++;
+			state->last_nonopt = state->optind;
+		}
+
+		// Everything after "--" is a non-option
+		if (state->optind != argc && strcmp(args[state->optind], "--") == 0) {
+			state->optind++;
+			if (state->first_nonopt != state->last_nonopt && state->last_nonopt != state->optind) _vex_getopt_exchange(state, args);
+			else if (state->first_nonopt == state->last_nonopt) state->first_nonopt = state->optind;
+			state->last_nonopt = argc;
+			state->optind = argc;
+		}
+
+		// Done, point optind at the first non-option
+		if (state->optind == argc) {
+			if (state->first_nonopt != state->last_nonopt) state->optind = state->first_nonopt;
+			return -1;
+		}
+		if (_VEX_GETOPT_NONOPTION(args[state->optind])) {
+			if (state->ordering == _VEX_GETOPT_REQUIRE_ORDER) return -1;
+			state->optarg = args[state->optind++];
+			return 1;
+		}
+		if (longopts && args[state->optind][1] == '-') {
+			state->nextchar = &args[state->optind][2];
+			return _vex_getopt_long_option(state, argc, args, longindex, "--");
+		}
+		state->nextchar = &args[state->optind][1];
+	}
+
+	// Next character of a short option cluster
+	char c = *state->nextchar++;
+	int spec = state->short_table[(unsigned char)c];
+	if (*state->nextchar == '\0') state->optind++;
+	if (spec == 0) {
+		if (state->opterr && !state->missing_colon) fprintf(stderr, "%s: invalid option -- '%c'\n", args[0], c);
+		state->optopt = c;
+		return '?';
+	}
+	if (c == 'W' && state->w_semicolon && longopts) {
+		// "-W foo" and "-Wfoo" mean "--foo", which then takes its value as usual
+		if (*state->nextchar == '\0') {
+			if (state->optind == argc) {
+				if (state->opterr && !state->missing_colon) fprintf(stderr, "%s: option requires an argument -- '%c'\n", args[0], c);
+				state->optopt = c;
+				return state->missing_colon ? ':' : '?';
+			}
+			state->nextchar = args[state->optind];
+		}
+		return _vex_getopt_long_option(state, argc, args, longindex, "-W ");
+	}
+	if (spec - 1 == VEX_OPTIONAL_ARGUMENT) {
+		// Only an attached value counts
+		if (*state->nextchar != '\0') {
+			state->optarg = state->nextchar;
+			state->optind++;
+		}
+		state->nextchar = NULL;
+	}
+	else if (spec - 1 == VEX_REQUIRED_ARGUMENT) {
+		if (*state->nextchar != '\0') {
+			state->optarg = state->nextchar;
+			state->optind++;
+		}
+		else if (state->optind == argc) {
+			if (state->opterr && !state->missing_colon) fprintf(stderr, "%s: option requires an argument -- '%c'\n", args[0], c);
+			state->optopt = c;
+			c = state->missing_colon ? ':' : '?';
+		}
+		else state->optarg = args[state->optind++];
+		state->nextchar = NULL;
+	}
+	return c;
+}
+
+void vex_getopt_free(vex_getopt* state) {
+	if (state->long_table) VEX_FREE(state->long_table);
+	state->long_table = NULL;
+	state->num_long = 0;
+	state->capacity_long = 0;
 }
 
 #endif
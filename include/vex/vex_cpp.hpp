@@ -2,67 +2,296 @@
 #include <string>
 #include <iterator>
 #include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Lazy parsing needs compiler support for coroutines
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#define VEX_HAS_COROUTINES
+#endif
 
 class vex {
 public:
-	vex(const std::string& name, const std::string& version, const std::string description);
+	vex(const std::string& name, const std::string& version, const std::string description, int flags = 0);
 	~vex();
 
-	bool add_arg(const std::string& description, int arg_type, const std::string& long_name, char short_name);
+	bool add_arg(const std::string& description, int arg_type, const std::string& long_name, char short_name, int max_count = 0, int flags = 0);
+
+	bool add_pos(const std::string& description, int arg_type, const std::string& name, int max_count = 1, int flags = 0);
+
+	int add_group(const std::string& prefix, const vex_arg_desc* descs, int count);
+
+	bool remove_group(int group);
 
 	bool parse(int argc, char** argv);
 
+	bool parse_string(char* str);
+
 	int token_count();
 
 	const vex_arg_token* get_token(int num);
 
+	int pos_count();
+
+	const vex_arg_token* get_pos(int slot);
+
+	char** get_passthrough(int& count);
+
 	bool arg_found(const std::string& name);
 
 	std::string get_version();
 
 	std::string get_help();
 
-	struct iterator_type {
+	std::string build_cmdline(const std::string& argv0);
+
+	int status() const;
+
+	template <typename T>
+	struct basic_iterator {
 		using iterator_category = std::random_access_iterator_tag;
+#if __cplusplus >= 202002L
+		using iterator_concept  = std::contiguous_iterator_tag;
+#endif
 		using difference_type   = std::ptrdiff_t;
 		using value_type        = vex_arg_token;
-		using pointer           = vex_arg_token*;
-		using reference         = vex_arg_token&;
+		using element_type      = T;
+		using pointer           = T*;
+		using reference         = T&;
+
+		basic_iterator() : m_ptr(nullptr) {}
+		explicit basic_iterator(T* ptr) : m_ptr(ptr) {}
+		template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+		basic_iterator(const basic_iterator<U>& other) : m_ptr(other.operator->()) {}
+
+		reference operator*() const { return *m_ptr; }
+		pointer operator->() const { return m_ptr; }
+		reference operator[](difference_type n) const { return m_ptr[n]; }
+
+		basic_iterator& operator++() { ++m_ptr; return *this; }
+		basic_iterator operator++(int) { basic_iterator tmp(*this); ++m_ptr; return tmp; }
+		basic_iterator& operator--() { --m_ptr; return *this; }
+		basic_iterator operator--(int) { basic_iterator tmp(*this); --m_ptr; return tmp; }
+
+		basic_iterator& operator+=(difference_type n) { m_ptr += n; return *this; }
+		basic_iterator& operator-=(difference_type n) { m_ptr -= n; return *this; }
+
+		friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+		friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+		friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+		friend difference_type operator-(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr - rhs.m_ptr; }
+
+		friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr == rhs.m_ptr; }
+		friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr != rhs.m_ptr; }
+		friend bool operator<(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr < rhs.m_ptr; }
+		friend bool operator>(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr > rhs.m_ptr; }
+		friend bool operator<=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr <= rhs.m_ptr; }
+		friend bool operator>=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.m_ptr >= rhs.m_ptr; }
+	private:
+		T* m_ptr;
+	};
+
+	using iterator_type = basic_iterator<vex_arg_token>;
+	using iterator = iterator_type;
+	using const_iterator = basic_iterator<const vex_arg_token>;
+	using riterator = std::reverse_iterator<iterator>;
+	using const_riterator = std::reverse_iterator<const_iterator>;
+
+	// Values of one token read as a single type, without copying them out of the parser
+	template <typename T>
+	class value_view {
+	public:
+		struct iterator {
+			using iterator_category = std::random_access_iterator_tag;
+			using difference_type   = std::ptrdiff_t;
+			using value_type        = T;
+			using pointer           = void;
+			using reference         = T;
+
+			const vex_value* ptr;
+
+			iterator() : ptr(nullptr) {}
+			explicit iterator(const vex_value* p) : ptr(p) {}
+
+			T operator*() const { return get(*ptr); }
+			T operator[](difference_type n) const { return get(ptr[n]); }
+			iterator& operator++() { ++ptr; return *this; }
+			iterator operator++(int) { iterator tmp(*this); ++ptr; return tmp; }
+			iterator& operator--() { --ptr; return *this; }
+			iterator operator--(int) { iterator tmp(*this); --ptr; return tmp; }
+			iterator& operator+=(difference_type n) { ptr += n; return *this; }
+			iterator& operator-=(difference_type n) { ptr -= n; return *this; }
+			friend iterator operator+(iterator it, difference_type n) { return it += n; }
+			friend iterator operator+(difference_type n, iterator it) { return it += n; }
+			friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+			friend difference_type operator-(const iterator& lhs, const iterator& rhs) { return lhs.ptr - rhs.ptr; }
+			friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.ptr == rhs.ptr; }
+			friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.ptr != rhs.ptr; }
+			friend bool operator<(const iterator& lhs, const iterator& rhs) { return lhs.ptr < rhs.ptr; }
+			friend bool operator>(const iterator& lhs, const iterator& rhs) { return lhs.ptr > rhs.ptr; }
+			friend bool operator<=(const iterator& lhs, const iterator& rhs) { return lhs.ptr <= rhs.ptr; }
+			friend bool operator>=(const iterator& lhs, const iterator& rhs) { return lhs.ptr >= rhs.ptr; }
+		};
+
+		value_view() : m_data(nullptr), m_size(0) {}
+		value_view(const vex_value* data, std::size_t size) : m_data(data), m_size(size) {}
+
+		iterator begin() const { return iterator(m_data); }
+		iterator end() const { return iterator(m_data + m_size); }
+		std::size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		T operator[](std::size_t n) const { return get(m_data[n]); }
+		const vex_value* data() const { return m_data; }
+
+		static T get(const vex_value& value) {
+			static_assert(std::is_same<T, int>::value || std::is_same<T, double>::value || std::is_same<T, const char*>::value,
+				"vex values are int, double or const char*");
+			return read_value(value, static_cast<T*>(nullptr));
+		}
+	private:
+		const vex_value* m_data;
+		std::size_t m_size;
+	};
+
+	// Tokens of one option, filtered while iterating. Options are matched by the name pointer their tokens share with
+	// the descriptor, so long-only options never match guessed tokens; short-only options by their short name
+	class token_filter {
+	public:
+		struct iterator {
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type   = std::ptrdiff_t;
+			using value_type        = vex_arg_token;
+			using pointer           = const vex_arg_token*;
+			using reference         = const vex_arg_token&;
+
+			const vex_arg_token* ptr;
+			const vex_arg_token* last;
+			const char* long_name;
+			char short_name;
+
+			iterator() : ptr(nullptr), last(nullptr), long_name(nullptr), short_name('\0') {}
+			iterator(const vex_arg_token* p, const vex_arg_token* l, const char* ln, char sn) : ptr(p), last(l), long_name(ln), short_name(sn) {}
+
+			reference operator*() const { return *ptr; }
+			pointer operator->() const { return ptr; }
+			iterator& operator++() {
+				do { ++ptr; } while (ptr != last && !matches(*ptr, long_name, short_name));
+				return *this;
+			}
+			iterator operator++(int) { iterator tmp(*this); ++*this; return tmp; }
+			friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.ptr == rhs.ptr; }
+			friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.ptr != rhs.ptr; }
+		};
+
+		token_filter() : m_first(nullptr), m_last(nullptr), m_long_name(nullptr), m_short_name('\0') {}
+		token_filter(const vex_arg_token* first, const vex_arg_token* last, const char* long_name, char short_name)
+			: m_first(first), m_last(last), m_long_name(long_name), m_short_name(short_name) {
+			while (m_first != m_last && !matches(*m_first, m_long_name, m_short_name)) ++m_first;
+		}
+
+		iterator begin() const { return iterator(m_first, m_last, m_long_name, m_short_name); }
+		iterator end() const { return iterator(m_last, m_last, m_long_name, m_short_name); }
+		bool empty() const { return m_first == m_last; }
+
+		static bool matches(const vex_arg_token& token, const char* long_name, char short_name) {
+			return long_name ? token.long_name == long_name : token.short_name == short_name;
+		}
+	private:
+		const vex_arg_token* m_first;
+		const vex_arg_token* m_last;
+		const char* m_long_name;
+		char m_short_name;
+	};
+
+	template <typename T>
+	value_view<T> values(const std::string& name) const {
+		const vex_arg_token* token = find_values(name);
+		return typed_view<T>(token);
+	}
 
-		iterator_type(const vex_ctx* m_ctx, std::size_t idx);
+	token_filter of(const std::string& name) const;
 
-		reference operator*() const;
-		pointer operator->();
+	struct token_view {
+		const vex_arg_token* token;
+		int slot;
 
-		iterator_type& operator++();
-		iterator_type operator++(int);
-		iterator_type& operator--();
-		iterator_type operator--(int);
+		bool is_pos() const { return slot >= 0; }
+		int count() const { return token->arg_count; }
 
-		iterator_type& operator+=(const difference_type& x);
-		iterator_type& operator+=(const iterator_type& x);
-		iterator_type& operator-=(const difference_type& x);
-		iterator_type& operator-=(const iterator_type& x);
+		// A value of another type, or past the last one, reads as T()
+		template <typename T>
+		T value(int num = 0) const {
+			if (token->arg_type != type_of(static_cast<T*>(nullptr)) || num < 0 || num >= token->arg_count) return T();
+			return read_value(token->arg[num], static_cast<T*>(nullptr));
+		}
 
-		friend iterator_type operator+(iterator_type lhs, const iterator_type& rhs);
-		friend iterator_type operator-(iterator_type lhs, const iterator_type& rhs);
+		template <typename T>
+		value_view<T> values() const { return typed_view<T>(token); }
+	};
 
-		friend bool operator==(const iterator_type& lhs, const iterator_type& rhs);
-		friend bool operator!=(const iterator_type& lhs, const iterator_type& rhs);
+#ifdef VEX_HAS_COROUTINES
+	template <typename T>
+	class generator {
+	public:
+		struct promise_type {
+			const T* value = nullptr;
+			std::exception_ptr exception;
+
+			generator get_return_object() { return generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			std::suspend_always yield_value(const T& v) noexcept {
+				value = std::addressof(v);
+				return {};
+			}
+			void return_void() noexcept {}
+			void unhandled_exception() { exception = std::current_exception(); }
+		};
+
+		struct sentinel {};
+
+		struct iterator {
+			using iterator_category = std::input_iterator_tag;
+			using difference_type   = std::ptrdiff_t;
+			using value_type        = T;
+			using pointer           = const T*;
+			using reference         = const T&;
+
+			std::coroutine_handle<promise_type> handle;
+
+			reference operator*() const { return *handle.promise().value; }
+			pointer operator->() const { return handle.promise().value; }
+			iterator& operator++() {
+				handle.resume();
+				if (handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+				return *this;
+			}
+			void operator++(int) { ++*this; }
+			friend bool operator==(const iterator& it, sentinel) { return it.handle.done(); }
+			friend bool operator!=(const iterator& it, sentinel) { return !it.handle.done(); }
+		};
+
+		explicit generator(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+		generator(generator&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+		generator(const generator&) = delete;
+		generator& operator=(const generator&) = delete;
+		~generator() { if (m_handle) m_handle.destroy(); }
+
+		iterator begin() {
+			iterator it{ m_handle };
+			++it;
+			return it;
+		}
+		sentinel end() { return {}; }
 
-		friend bool operator<(const iterator_type& lhs, const iterator_type& rhs);
-		friend bool operator>(const iterator_type& lhs, const iterator_type& rhs);
-		friend bool operator<=(const iterator_type& lhs, const iterator_type& rhs);
-		friend bool operator>=(const iterator_type& lhs, const iterator_type& rhs);
 	private:
-		const vex_ctx* m_ctx;
-		std::size_t m_idx;
+		std::coroutine_handle<promise_type> m_handle;
 	};
 
-	using iterator = iterator_type;
-	using const_iterator = const iterator_type;
-	using riterator = std::reverse_iterator<iterator>;
-	using const_riterator = std::reverse_iterator<const_iterator>;
+	generator<token_view> lazy_parse(int argc, char** argv);
+#endif
 
 	iterator begin();
 	const_iterator begin() const;
@@ -78,103 +307,34 @@ public:
 	const_riterator crend() const;
 
 private:
+	const vex_arg_token* find_values(const std::string& name) const;
+
+	// One overload per value type, picked by the pointer type so no C++17 is needed
+	static int read_value(const vex_value& value, int*) { return value.int_arg; }
+	static double read_value(const vex_value& value, double*) { return value.dub_arg; }
+	static const char* read_value(const vex_value& value, const char**) { return value.str_arg; }
+	static std::string read_value(const vex_value& value, std::string*) { return std::string(value.str_arg); }
+
+	// The token type each of them reads, so a mismatch never reinterprets the union
+	static int type_of(int*) { return VEX_ARG_TYPE_INT; }
+	static int type_of(double*) { return VEX_ARG_TYPE_DUB; }
+	static int type_of(const char**) { return VEX_ARG_TYPE_STR; }
+	static int type_of(std::string*) { return VEX_ARG_TYPE_STR; }
+
+	template <typename T>
+	static value_view<T> typed_view(const vex_arg_token* token) {
+		if (!token || token->arg_type != type_of(static_cast<T*>(nullptr))) return value_view<T>();
+		return value_view<T>(token->arg, static_cast<std::size_t>(token->arg_count));
+	}
+
 	vex_ctx ctx;
 };
 
 #ifdef VEX_IMPLEMENTATION
 
-vex::iterator::iterator_type(const vex_ctx* ctx, std::size_t idx) {
-	m_ctx = ctx;
-	m_idx = idx;
-}
-
-vex::iterator::reference vex::iterator::operator*() const {
-	return m_ctx->arg_token[m_idx];
-}
-
-vex::iterator::pointer vex::iterator::operator->() {
-	return &m_ctx->arg_token[m_idx];
-}
-
-vex::iterator& vex::iterator::operator++() {
-	m_idx++;
-	return *this;
-}
+vex::iterator vex::begin()                { return iterator(ctx.arg_token); }
 
-vex::iterator vex::iterator::operator++(int) {
-	vex::iterator tmp(*this);
-	operator++();
-	return tmp;
-}
-
-vex::iterator& vex::iterator::operator--() {
-	m_idx--;
-	return *this;
-}
-
-vex::iterator vex::iterator::operator--(int) {
-	vex::iterator tmp(*this);
-	operator--();
-	return tmp;
-}
-
-vex::iterator& vex::iterator::operator+=(const difference_type& x) {
-	m_idx += x;
-	return *this;
-}
-
-vex::iterator& vex::iterator::operator+=(const vex::iterator_type& x) {
-	m_idx += x.m_idx;
-	return *this;
-}
-
-vex::iterator& vex::iterator::operator-=(const difference_type& x) {
-	m_idx -= x;
-	return *this;
-}
-
-vex::iterator& vex::iterator::operator-=(const vex::iterator_type& x) {
-	m_idx -= x.m_idx;
-	return *this;
-}
-
-vex::iterator operator+(vex::iterator_type lhs, const vex::iterator_type& rhs) {
-	lhs += rhs;
-	return lhs;
-}
-
-vex::iterator operator-(vex::iterator_type lhs, const vex::iterator_type& rhs) {
-	lhs -= rhs;
-	return lhs;
-}
-
-bool operator==(const vex::iterator_type& lhs, const vex::iterator_type& rhs) {
-	return (lhs.m_ctx == rhs.m_ctx && lhs.m_idx == rhs.m_idx);
-}
-
-bool operator!=(const vex::iterator_type& lhs, const vex::iterator_type& rhs) {
-	return !(lhs == rhs);
-}
-
-bool operator<(const vex::iterator_type& lhs, const vex::iterator_type& rhs) {
-	return lhs.m_idx < rhs.m_idx;
-}
-
-bool operator>(const vex::iterator_type& lhs, const vex::iterator_type& rhs) {
-	return rhs.m_idx < lhs.m_idx;
-}
-
-bool operator<=(const vex::iterator_type& lhs, const vex::iterator_type& rhs) {
-	return !(lhs.m_idx < rhs.m_idx);
-}
-
-bool operator>=(const vex::iterator_type& lhs, const vex::iterator_type& rhs) {
-	return !(lhs.m_idx > rhs.m_idx);
-}
-
-vex::iterator vex::begin()                { return iterator(&ctx, 0); }
-
-vex::const_iterator vex::begin() const    { return iterator(&ctx, 0); }
+vex::const_iterator vex::begin() const    { return const_iterator(ctx.arg_token); }
 
 vex::riterator vex::rbegin()              { return riterator(end()); }
 
@@ -184,9 +344,9 @@ vex::const_iterator vex::cbegin() const   { return begin(); }
 
 vex::const_riterator vex::crbegin() const { return rbegin(); }
 
-vex::iterator vex::end()                  { return iterator(&ctx, ctx.num_arg_token); }
+vex::iterator vex::end()                  { return iterator(ctx.arg_token + ctx.num_arg_token); }
 
-vex::const_iterator vex::end() const      { return iterator(&ctx, ctx.num_arg_token); }
+vex::const_iterator vex::end() const      { return const_iterator(ctx.arg_token + ctx.num_arg_token); }
 
 vex::riterator vex::rend()                { return riterator(begin()); }
 
@@ -196,11 +356,12 @@ vex::const_iterator vex::cend() const     { return end(); }
 
 vex::const_riterator vex::crend() const   { return rend(); }
 
-vex::vex(const std::string& name, const std::string& version, const std::string description) {
+vex::vex(const std::string& name, const std::string& version, const std::string description, int flags) {
 	vex_init_info info = { 0 };
 	info.name = name.c_str();
 	info.version = version.c_str();
 	info.description = description.c_str();
+	info.flags = flags;
 	vex_init(&ctx, info);
 }
 
@@ -208,19 +369,43 @@ vex::~vex() {
 	vex_free(&ctx);
 }
 
-bool vex::add_arg(const std::string& description, int arg_type, const std::string& long_name, char short_name) {
+bool vex::add_arg(const std::string& description, int arg_type, const std::string& long_name, char short_name, int max_count, int flags) {
 	vex_arg_desc desc = { 0 };
 	desc.arg_type = arg_type;
 	desc.description = const_cast<char*>(description.c_str());
 	desc.long_name = const_cast<char*>(long_name.c_str());
 	desc.short_name = short_name;
+	desc.max_count = max_count;
+	desc.flags = flags;
 	return vex_add_arg(&ctx, desc);
 }
 
+bool vex::add_pos(const std::string& description, int arg_type, const std::string& name, int max_count, int flags) {
+	vex_pos_desc desc = { 0 };
+	desc.arg_type = arg_type;
+	desc.description = const_cast<char*>(description.c_str());
+	desc.name = const_cast<char*>(name.c_str());
+	desc.max_count = max_count;
+	desc.flags = flags;
+	return vex_add_pos(&ctx, desc);
+}
+
+int vex::add_group(const std::string& prefix, const vex_arg_desc* descs, int count) {
+	return vex_add_group(&ctx, prefix.c_str(), descs, count);
+}
+
+bool vex::remove_group(int group) {
+	return vex_remove_group(&ctx, group);
+}
+
 bool vex::parse(int argc, char** argv) {
 	return vex_parse(&ctx, argc, argv);
 }
 
+bool vex::parse_string(char* str) {
+	return vex_parse_string(&ctx, str);
+}
+
 int vex::token_count() {
 	return vex_token_count(&ctx);
 }
@@ -229,6 +414,18 @@ const vex_arg_token* vex::get_token(int num) {
 	return vex_get_token(&ctx, num);
 }
 
+int vex::pos_count() {
+	return vex_pos_count(&ctx);
+}
+
+const vex_arg_token* vex::get_pos(int slot) {
+	return vex_get_pos(&ctx, slot);
+}
+
+char** vex::get_passthrough(int& count) {
+	return vex_get_passthrough(&ctx, &count);
+}
+
 bool vex::arg_found(const std::string& name) {
 	return vex_arg_found(&ctx, name.c_str());
 }
@@ -241,4 +438,48 @@ std::string vex::get_help() {
 	return std::string(vex_get_help(&ctx));
 }
 
+int vex::status() const {
+	return ctx.status;
+}
+
+const vex_arg_token* vex::find_values(const std::string& name) const {
+	// Positional slots by name, then the first token of an option
+	for (int i = 0; i < ctx.num_pos_desc; ++i) {
+		if (name == ctx.pos_desc[i].name) return &ctx.pos_token[i];
+	}
+	token_filter tokens = of(name);
+	return tokens.empty() ? nullptr : &*tokens.begin();
+}
+
+vex::token_filter vex::of(const std::string& name) const {
+	// Removed slots have neither name, so they never match
+	for (int d = 0; d < ctx.num_arg_desc; ++d) {
+		const vex_arg_desc& desc = ctx.arg_desc[d];
+		if ((name.size() == 1 && desc.short_name != '\0' && name[0] == desc.short_name) || (desc.long_name && name == desc.long_name)) {
+			return token_filter(ctx.arg_token, ctx.arg_token + ctx.num_arg_token, desc.long_name, desc.short_name);
+		}
+	}
+	return token_filter();
+}
+
+#ifdef VEX_HAS_COROUTINES
+vex::generator<vex::token_view> vex::lazy_parse(int argc, char** argv) {
+	// Arguments are only parsed as far as the caller keeps asking for tokens
+	vex_stream stream;
+	vex_stream_begin(&ctx, &stream, argc, argv);
+	int slot = -1;
+	while (const vex_arg_token* token = vex_stream_next(&ctx, &stream, &slot)) {
+		co_yield token_view{ token, slot };
+	}
+}
+#endif
+
+std::string vex::build_cmdline(const std::string& argv0) {
+	char* cmdline = vex_build_cmdline(&ctx, argv0.c_str(), NULL, 0);
+	if (!cmdline) return std::string();
+	std::string str(cmdline);
+	vex_free_buffer(cmdline);
+	return str;
+}
+
 #endif
\ No newline at end of file
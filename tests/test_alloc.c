@@ -0,0 +1,467 @@
+/*
+ test_alloc.c
+
+ Counts every allocation made through the VEX_MALLOC/VEX_REALLOC/VEX_FREE hooks and checks the budget of each
+ API call, so allocations creeping into the hot path fail the build.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+	long allocs;
+	long frees;
+	long live;
+	size_t live_bytes;
+} alloc_counts;
+
+static alloc_counts counts;
+
+// Number of allocations to let through before failing, or -1 to never fail
+static long fail_after = -1;
+
+// Each block is prefixed with its size so frees and leaks can be sized
+typedef union {
+	size_t size;
+	long double align_ld;
+	void* align_ptr;
+} alloc_header;
+
+static void* test_malloc(size_t size) {
+	if (fail_after == 0) return NULL;
+	if (fail_after > 0) fail_after--;
+	alloc_header* header = (alloc_header*)malloc(sizeof(alloc_header) + size);
+	if (!header) return NULL;
+	header->size = size;
+	counts.allocs++;
+	counts.live++;
+	counts.live_bytes += size;
+	return header + 1;
+}
+
+static void test_free(void* ptr) {
+	if (!ptr) return;
+	alloc_header* header = (alloc_header*)ptr - 1;
+	counts.frees++;
+	counts.live--;
+	counts.live_bytes -= header->size;
+	free(header);
+}
+
+static void* test_realloc(void* ptr, size_t size) {
+	if (!ptr) return test_malloc(size);
+	if (fail_after == 0) return NULL;
+	if (fail_after > 0) fail_after--;
+	alloc_header* header = (alloc_header*)ptr - 1;
+	size_t old_size = header->size;
+	alloc_header* temp = (alloc_header*)realloc(header, sizeof(alloc_header) + size);
+	if (!temp) return NULL;
+	temp->size = size;
+	counts.allocs++;
+	counts.live_bytes += size;
+	counts.live_bytes -= old_size;
+	return temp + 1;
+}
+
+#define VEX_MALLOC test_malloc
+#define VEX_REALLOC test_realloc
+#define VEX_FREE test_free
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+// Runs a statement and checks how many allocations it made
+#define CHECK_ALLOCS(expected, stmt) do { \
+		long before = counts.allocs; \
+		stmt; \
+		long made = counts.allocs - before; \
+		if (made != (expected)) { \
+			fprintf(stderr, "%s:%d: %s made %ld allocations, expected %d\n", __FILE__, __LINE__, #stmt, made, (expected)); \
+			failures++; \
+		} \
+	} while (0)
+
+#define CHECK_NO_LEAKS() do { \
+		if (counts.live != 0) { \
+			fprintf(stderr, "%s:%d: %ld blocks (%lu bytes) leaked\n", __FILE__, __LINE__, counts.live, (unsigned long)counts.live_bytes); \
+			failures++; \
+		} \
+	} while (0)
+
+static void setup(vex_ctx* ctx) {
+	vex_init_info info = { "app", "1.0", "Allocation test", VEX_FLAG_PASS_REMAINDER };
+	CHECK(vex_init(ctx, info));
+
+	vex_arg_desc desc = { 0 };
+	desc.description = "Input file";
+	desc.long_name = "input";
+	desc.short_name = 'i';
+	desc.arg_type = VEX_ARG_TYPE_STR;
+	desc.max_count = -1;
+	CHECK(vex_add_arg(ctx, desc));
+	desc.description = "Thread count";
+	desc.long_name = "threads";
+	desc.short_name = 't';
+	desc.arg_type = VEX_ARG_TYPE_INT;
+	desc.max_count = 1;
+	CHECK(vex_add_arg(ctx, desc));
+	desc.description = "Scale factor";
+	desc.long_name = "scale";
+	desc.short_name = 's';
+	desc.arg_type = VEX_ARG_TYPE_DUB;
+	desc.max_count = 2;
+	CHECK(vex_add_arg(ctx, desc));
+	desc.description = "Be verbose";
+	desc.long_name = "verbose";
+	desc.short_name = 'V';
+	desc.arg_type = VEX_ARG_TYPE_FLAG;
+	desc.max_count = 0;
+	CHECK(vex_add_arg(ctx, desc));
+
+	vex_pos_desc pos = { 0 };
+	pos.description = "Output file";
+	pos.name = "output";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	CHECK(vex_add_pos(ctx, pos));
+	pos.description = "Extra numbers";
+	pos.name = "numbers";
+	pos.arg_type = VEX_ARG_TYPE_INT;
+	pos.max_count = -1;
+	CHECK(vex_add_pos(ctx, pos));
+}
+
+static void test_init_free(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_reparse(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char* argv[] = { "app", "-i", "a.txt", "b.txt", "--threads=4", "-s", "1.5", "2.5", "-V", "out.txt", "1", "2", "3", "--", "rest" };
+	int argc = (int)(sizeof(argv) / sizeof(argv[0]));
+
+	// The first parse sizes the buffers, after that the same shape of input must not allocate
+	CHECK(vex_parse(&ctx, argc, argv));
+	CHECK_ALLOCS(0, CHECK(vex_parse(&ctx, argc, argv)));
+	CHECK_ALLOCS(0, CHECK(vex_parse(&ctx, argc, argv)));
+	CHECK(vex_token_count(&ctx) == 4);
+	CHECK(strcmp(vex_get_token(&ctx, 0)->arg[1].str_arg, "b.txt") == 0);
+	CHECK(vex_get_pos(&ctx, 1)->arg_count == 3);
+
+	// Smaller inputs fit in what's already there
+	char* small[] = { "app", "-i", "c.txt", "out.txt" };
+	CHECK_ALLOCS(0, CHECK(vex_parse(&ctx, 4, small)));
+	CHECK(strcmp(vex_get_token(&ctx, 0)->arg[0].str_arg, "c.txt") == 0);
+	CHECK_ALLOCS(0, CHECK(vex_parse(&ctx, argc, argv)));
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_queries(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char* argv[] = { "app", "-V", "--input", "x", "out.txt" };
+	CHECK(vex_parse(&ctx, 5, argv));
+
+	vex_result result;
+	int count = 0;
+	CHECK_ALLOCS(0, CHECK(vex_arg_found(&ctx, "verbose")));
+	CHECK_ALLOCS(0, CHECK(vex_arg_found(&ctx, "i")));
+	CHECK_ALLOCS(0, CHECK(!vex_arg_found(&ctx, "threads")));
+	CHECK_ALLOCS(0, CHECK(vex_token_count(&ctx) == 2));
+	CHECK_ALLOCS(0, CHECK(vex_get_token(&ctx, 1) != NULL));
+	CHECK_ALLOCS(0, CHECK(vex_pos_count(&ctx) == 2));
+	CHECK_ALLOCS(0, vex_get_passthrough(&ctx, &count));
+	CHECK_ALLOCS(0, vex_get_result(&ctx, &result));
+	CHECK_ALLOCS(0, vex_get_version(&ctx));
+
+	// Help text is built once and then cached
+	CHECK_ALLOCS(1, CHECK(vex_get_help(&ctx) != NULL));
+	CHECK_ALLOCS(0, CHECK(vex_get_help(&ctx) != NULL));
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_parse_string(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char buffer[128];
+	const char* cmdline = "-i 'a b.txt' \"c.txt\" -t 8 out.txt 4 5";
+	strcpy(buffer, cmdline);
+	CHECK(vex_parse_string(&ctx, buffer));
+	strcpy(buffer, cmdline);
+	CHECK_ALLOCS(0, CHECK(vex_parse_string(&ctx, buffer)));
+	CHECK(strcmp(vex_get_token(&ctx, 0)->arg[0].str_arg, "a b.txt") == 0);
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_parse_suffix(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char* prefix[] = { "app", "-V", "-i", "shared.txt", "-t", "4" };
+	char* suffix_a[] = { "out_a.txt", "1" };
+	char* suffix_b[] = { "out_b.txt", "2", "3" };
+	vex_checkpoint checkpoint;
+	CHECK(vex_parse_prefix(&ctx, 6, prefix, &checkpoint));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 2, suffix_a));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 3, suffix_b));
+
+	// Alternating suffixes reuse the same space
+	for (int i = 0; i < 4; ++i) {
+		CHECK_ALLOCS(0, CHECK(vex_parse_suffix(&ctx, &checkpoint, 2, suffix_a)));
+		CHECK(vex_get_pos(&ctx, 1)->arg_count == 1);
+		CHECK_ALLOCS(0, CHECK(vex_parse_suffix(&ctx, &checkpoint, 3, suffix_b)));
+		CHECK(vex_get_pos(&ctx, 1)->arg_count == 2);
+		CHECK(strcmp(vex_get_pos(&ctx, 0)->arg[0].str_arg, "out_b.txt") == 0);
+		CHECK(strcmp(vex_get_token(&ctx, 1)->arg[0].str_arg, "shared.txt") == 0);
+	}
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_errors(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char* argv[] = { "app", "--bogus" };
+	CHECK(!vex_parse(&ctx, 2, argv));
+	CHECK(ctx.status == VEX_STATUS_UNKNOWN_ARG);
+
+	// The status message buffer is reused
+	CHECK_ALLOCS(0, CHECK(!vex_parse(&ctx, 2, argv)));
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_large_input(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	enum { NUM_ARGS = 20000 };
+	static char storage[NUM_ARGS][16];
+	static char* argv[NUM_ARGS + 3];
+	argv[0] = "app";
+	argv[1] = "-i";
+	for (int a = 0; a < NUM_ARGS; ++a) {
+		snprintf(storage[a], sizeof(storage[a]), "file%d.txt", a);
+		argv[a + 2] = storage[a];
+	}
+	argv[NUM_ARGS + 2] = "out.txt";
+
+	// Value buffers grow geometrically rather than once per value
+	long before = counts.allocs;
+	CHECK(vex_parse(&ctx, NUM_ARGS + 3, argv));
+	CHECK(counts.allocs - before < 100);
+	CHECK(vex_get_token(&ctx, 0)->arg_count == NUM_ARGS + 1);
+	CHECK_ALLOCS(0, CHECK(vex_parse(&ctx, NUM_ARGS + 3, argv)));
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_memory_usage(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char* argv[] = { "app", "-i", "a.txt", "b.txt", "-V", "out.txt", "1", "2" };
+	char* small[] = { "app", "out.txt" };
+	CHECK(vex_parse(&ctx, 8, argv));
+
+	// Every live allocation is accounted for
+	vex_memory usage;
+	CHECK_ALLOCS(0, usage = vex_memory_usage(&ctx));
+	CHECK(usage.total == counts.live_bytes);
+	CHECK(usage.tokens == 2 * sizeof(vex_arg_token));
+	CHECK(usage.string_values == strlen("a.txt b.txt out.txt") + 1);
+	CHECK(usage.help_cache == 0);
+
+	// Space kept from a larger parse shows up as slack
+	CHECK(vex_parse(&ctx, 2, small));
+	vex_memory after = vex_memory_usage(&ctx);
+	CHECK(after.total == usage.total);
+	CHECK(after.tokens == 0);
+	CHECK(after.string_values == strlen("out.txt") + 1);
+	CHECK(after.slack > usage.slack);
+
+	CHECK(vex_get_help(&ctx) != NULL);
+	usage = vex_memory_usage(&ctx);
+	CHECK(usage.help_cache == strlen(vex_get_help(&ctx)) + 1);
+	CHECK(usage.total <= counts.live_bytes);
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_interning(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	ctx.flags |= VEX_FLAG_INTERN_STRINGS;
+	char* argv[] = { "app", "a.txt", "-i", "a.txt", "b.txt", "a.txt" };
+	char* other[] = { "app", "a.txt", "-i", "b.txt", "c.txt" };
+
+	// Equal values share one copy, within a parse and across parses
+	CHECK(vex_parse(&ctx, 6, argv));
+	const vex_arg_token* token = vex_get_token(&ctx, 0);
+	const char* a = token->arg[0].str_arg;
+	const char* b = token->arg[1].str_arg;
+	CHECK(strcmp(a, "a.txt") == 0 && strcmp(b, "b.txt") == 0);
+	CHECK(token->arg[2].str_arg == a);
+	CHECK(vex_get_pos(&ctx, 0)->arg[0].str_arg == a);
+	CHECK(ctx.num_intern == 2);
+	CHECK_ALLOCS(0, CHECK(vex_parse(&ctx, 6, argv)));
+	CHECK(vex_get_token(&ctx, 0)->arg[1].str_arg == b);
+	CHECK(vex_parse(&ctx, 5, other));
+	CHECK(vex_get_token(&ctx, 0)->arg[0].str_arg == b);
+	CHECK(vex_get_pos(&ctx, 0)->arg[0].str_arg == a);
+	CHECK(ctx.num_intern == 3);
+
+	// The table and its text are accounted for, and only released on request
+	vex_memory usage = vex_memory_usage(&ctx);
+	CHECK(usage.total == counts.live_bytes);
+	CHECK(usage.string_values == 0);
+	CHECK(usage.interned == ctx.capacity_intern * sizeof(vex_intern_entry) + 3 * (strlen("a.txt") + 1));
+	vex_clear_interned(&ctx);
+	CHECK(vex_memory_usage(&ctx).interned == 0);
+	CHECK(vex_parse(&ctx, 6, argv));
+	CHECK(ctx.num_intern == 2);
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static int add_plugin(vex_ctx* ctx, const char* prefix) {
+	vex_arg_desc descs[3];
+	memset(descs, 0, sizeof(descs));
+	descs[0].long_name = "level";
+	descs[0].description = "Plugin level";
+	descs[0].arg_type = VEX_ARG_TYPE_INT;
+	descs[0].max_count = 1;
+	descs[1].long_name = "name";
+	descs[1].arg_type = VEX_ARG_TYPE_STR;
+	descs[1].max_count = 1;
+	descs[2].long_name = "debug";
+	descs[2].description = "Plugin debugging";
+	descs[2].arg_type = VEX_ARG_TYPE_FLAG;
+	return vex_add_group(ctx, prefix, descs, 3);
+}
+
+static void test_add_arg(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+
+	// An option that runs out of memory partway, including when the name index grows, leaves nothing behind
+	char names[20][16];
+	for (int i = 0; i < 20; ++i) {
+		snprintf(names[i], sizeof(names[i]), "extra%d", i);
+		vex_arg_desc desc = { 0 };
+		desc.description = "Extra option";
+		desc.long_name = names[i];
+		desc.short_name = (char)('A' + i);
+		desc.arg_type = VEX_ARG_TYPE_INT;
+		desc.max_count = 1;
+		int num_desc = ctx.num_arg_desc;
+		for (long n = 0; ; ++n) {
+			fail_after = n;
+			bool ok = vex_add_arg(&ctx, desc);
+			fail_after = -1;
+			if (ok) break;
+			CHECK(ctx.status == VEX_STATUS_BAD_ALLOC);
+			CHECK(ctx.num_arg_desc == num_desc);
+		}
+		CHECK(ctx.num_arg_desc == num_desc + 1);
+	}
+	char* argv[] = { "app", "--extra19", "4", "-A", "1" };
+	CHECK(vex_parse(&ctx, 5, argv));
+	CHECK(vex_token_count(&ctx) == 2 && vex_get_token(&ctx, 1)->arg[0].int_arg == 1);
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+static void test_groups(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	int a = add_plugin(&ctx, "plugin.a");
+	int b = add_plugin(&ctx, "plugin.b");
+	CHECK(a >= 0 && b >= 0 && a != b);
+	int num_desc = ctx.num_arg_desc;
+	char* argv[] = { "app", "--plugin.a.level=3", "--plugin.b.name", "x", "--plugin.a.deb", "-V" };
+	CHECK(vex_parse(&ctx, 6, argv));
+	CHECK(vex_token_count(&ctx) == 4);
+	CHECK(strcmp(vex_get_token(&ctx, 0)->long_name, "plugin.a.level") == 0 && vex_get_token(&ctx, 0)->arg[0].int_arg == 3);
+	CHECK(vex_arg_found(&ctx, "plugin.b.name") && vex_arg_found(&ctx, "plugin.a.debug"));
+	CHECK(vex_memory_usage(&ctx).total == counts.live_bytes);
+	CHECK(strstr(vex_get_help(&ctx), "--plugin.b.level") != NULL);
+
+	// Names are checked before anything is added
+	CHECK(add_plugin(&ctx, "plugin.a") < 0);
+	vex_arg_desc bad = { 0 };
+	bad.long_name = "x.y";
+	CHECK(vex_add_group(&ctx, "plugin.c", &bad, 1) < 0);
+	bad.long_name = "verbose";
+	bad.short_name = 'V';
+	CHECK(vex_add_group(&ctx, "plugin.c", &bad, 1) < 0);
+	CHECK(ctx.status == VEX_STATUS_BAD_VALUE);
+	CHECK(ctx.num_arg_desc == num_desc);
+
+	// Removing a group leaves the other one and the base options alone, and its slots are reused
+	CHECK(vex_remove_group(&ctx, a));
+	CHECK(vex_token_count(&ctx) == 0);
+	CHECK(!vex_remove_group(&ctx, a));
+	CHECK(!vex_parse(&ctx, 6, argv));
+	CHECK(ctx.status == VEX_STATUS_UNKNOWN_ARG);
+	CHECK(strstr(vex_get_help(&ctx), "--plugin.a.level") == NULL);
+	char* rest[] = { "app", "--plugin.b.level", "4", "-i", "f" };
+	CHECK(vex_parse(&ctx, 5, rest));
+	CHECK(vex_token_count(&ctx) == 2 && vex_get_token(&ctx, 0)->arg[0].int_arg == 4);
+	for (int cycle = 0; cycle < 10; ++cycle) {
+		a = add_plugin(&ctx, "plugin.a");
+		CHECK(a >= 0);
+		CHECK(vex_remove_group(&ctx, a));
+	}
+	a = add_plugin(&ctx, "plugin.a");
+	CHECK(ctx.num_arg_desc == num_desc);
+	CHECK(vex_parse(&ctx, 6, argv));
+
+	// A group that runs out of memory partway leaves no trace
+	CHECK(vex_remove_group(&ctx, a));
+	int num_free = ctx.num_free_desc;
+	for (long n = 0; ; ++n) {
+		fail_after = n;
+		a = add_plugin(&ctx, "plugin.a");
+		fail_after = -1;
+		if (a >= 0) break;
+		CHECK(ctx.status == VEX_STATUS_BAD_ALLOC);
+		CHECK(ctx.num_arg_desc == num_desc && ctx.num_free_desc == num_free);
+		CHECK(!vex_parse(&ctx, 6, argv));
+	}
+	CHECK(vex_parse(&ctx, 6, argv));
+	vex_free(&ctx);
+	CHECK_NO_LEAKS();
+}
+
+int main(void) {
+	test_init_free();
+	test_reparse();
+	test_queries();
+	test_parse_string();
+	test_parse_suffix();
+	test_errors();
+	test_large_input();
+	test_memory_usage();
+	test_interning();
+	test_add_arg();
+	test_groups();
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All allocation checks passed\n");
+	return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ test_cpp.cpp
+
+ Checks the C++ wrapper's token iterators, typed value views and option filters against a known command line.
+ Built as C++11, the oldest standard the wrapper supports.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex_cpp.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+static void setup(vex& parser) {
+	CHECK(parser.add_arg("Ids to process", VEX_ARG_TYPE_INT, "ids", 'i', -1));
+	CHECK(parser.add_arg("Scale", VEX_ARG_TYPE_DUB, "scale", 's', 1));
+	CHECK(parser.add_arg("Names", VEX_ARG_TYPE_STR, "name", 'n', -1));
+
+	// Group members have no short name, like the tokens the parser guesses for unknown words
+	vex_arg_desc opts[1] = {};
+	opts[0].long_name = const_cast<char*>("level");
+	opts[0].arg_type = VEX_ARG_TYPE_INT;
+	opts[0].max_count = 1;
+	CHECK(parser.add_group("plugin", opts, 1) >= 0);
+}
+
+static void test_iterators() {
+	vex parser("app", "1.0", "Iterator test");
+	setup(parser);
+	char* argv[] = { (char*)"app", (char*)"stray", (char*)"-i", (char*)"1", (char*)"2", (char*)"--plugin.level=5",
+		(char*)"-n", (char*)"a", (char*)"b", (char*)"-s", (char*)"0.5", (char*)"-i", (char*)"3" };
+	CHECK(parser.parse(13, argv));
+	CHECK(parser.token_count() == 6);
+
+	// Forward, reverse and const iteration all walk the same contiguous array
+	const vex& view = parser;
+	CHECK(std::distance(parser.begin(), parser.end()) == parser.token_count());
+	CHECK(std::distance(parser.rbegin(), parser.rend()) == parser.token_count());
+	CHECK(&*parser.begin() == parser.get_token(0));
+	CHECK(&*parser.rbegin() == parser.get_token(5));
+	CHECK(view.cbegin() + 2 == view.cend() - 4);
+	CHECK(view.cend() - view.cbegin() == 6);
+	CHECK(view.begin()[3].long_name != NULL && std::strcmp(view.begin()[3].long_name, "name") == 0);
+	vex::const_iterator found = std::find_if(view.begin(), view.end(), [](const vex_arg_token& token) { return token.short_name == 's'; });
+	CHECK(found != view.end() && found->arg_count == 1 && found->arg[0].dub_arg == 0.5);
+	vex::iterator it = parser.begin();
+	it += 2;
+	CHECK(it - parser.begin() == 2 && it > parser.begin() && it[-1].short_name == 'i');
+
+	// Value views read the first matching token without copying
+	vex::value_view<int> ids = parser.values<int>("ids");
+	CHECK(ids.size() == 2 && ids[0] == 1 && ids[1] == 2);
+	int total = 0;
+	for (int id : ids) total += id;
+	CHECK(total == 3);
+	CHECK(*(ids.end() - 1) == 2 && ids.end() - ids.begin() == 2);
+	vex::value_view<const char*> names = parser.values<const char*>("n");
+	CHECK(names.size() == 2 && std::strcmp(names[1], "b") == 0);
+	CHECK(parser.values<double>("scale").size() == 1 && parser.values<double>("scale")[0] == 0.5);
+	CHECK(parser.values<int>("plugin.level").size() == 1 && parser.values<int>("plugin.level")[0] == 5);
+	CHECK(parser.values<int>("missing").empty());
+
+	// Typed reads of a single token, including as std::string
+	vex::token_view token = { parser.get_token(3), -1 };
+	CHECK(!token.is_pos() && token.count() == 2);
+	CHECK(token.value<std::string>(1) == "b");
+	CHECK(std::strcmp(token.value<const char*>(0), "a") == 0);
+	CHECK(token.values<const char*>().size() == 2);
+
+	// Asking for the wrong type gives nothing rather than reinterpreting the value
+	CHECK(parser.values<int>("name").empty());
+	CHECK(parser.values<const char*>("ids").empty());
+	CHECK(parser.values<double>("ids").empty());
+	CHECK(token.value<int>(0) == 0);
+	CHECK(token.value<std::string>(2).empty());
+	CHECK(token.values<double>().empty());
+	vex::token_view ids_token = { parser.get_token(1), -1 };
+	CHECK(ids_token.value<std::string>().empty() && ids_token.value<const char*>() == NULL && ids_token.value<int>(1) == 2);
+}
+
+static void test_filters() {
+	vex parser("app", "1.0", "Filter test");
+	setup(parser);
+	char* argv[] = { (char*)"app", (char*)"stray", (char*)"-i", (char*)"1", (char*)"--plugin.level=5", (char*)"other",
+		(char*)"-i", (char*)"3" };
+	CHECK(parser.parse(8, argv));
+
+	// Every token of the option, by long or short name, and nothing else
+	int count = 0;
+	for (const vex_arg_token& token : parser.of("ids")) {
+		CHECK(token.short_name == 'i');
+		count++;
+	}
+	CHECK(count == 2);
+	vex::token_filter short_ids = parser.of("i");
+	CHECK(std::distance(short_ids.begin(), short_ids.end()) == 2);
+
+	// A short-less option doesn't pick up the guessed tokens, which have no short name either
+	count = 0;
+	for (const vex_arg_token& token : parser.of("plugin.level")) {
+		CHECK(std::strcmp(token.long_name, "plugin.level") == 0 && token.arg[0].int_arg == 5);
+		count++;
+	}
+	CHECK(count == 1);
+	CHECK(parser.of("missing").empty());
+	CHECK(parser.of("scale").empty());
+}
+
+int main() {
+	test_iterators();
+	test_filters();
+	if (failures > 0) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	std::printf("All C++ checks passed\n");
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ test_cpp20.cpp
+
+ Checks the parts of the C++ wrapper that need C++20: the token iterators model contiguous iterators, and the
+ coroutine generator hands out the same tokens as a full parse, in the order a parse stream does.
+ */
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex_cpp.hpp"
+
+#ifndef VEX_HAS_COROUTINES
+#error "test_cpp20.cpp needs coroutine support"
+#endif
+
+static_assert(std::contiguous_iterator<vex::iterator>, "token iterators are contiguous");
+static_assert(std::contiguous_iterator<vex::const_iterator>, "const token iterators are contiguous");
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+static void setup(vex& parser) {
+	CHECK(parser.add_arg("Ids to process", VEX_ARG_TYPE_INT, "ids", 'i', -1));
+	CHECK(parser.add_arg("Level", VEX_ARG_TYPE_INT, "level", 'l', 1));
+	CHECK(parser.add_arg("Name", VEX_ARG_TYPE_STR, "name", 'n', 1));
+	CHECK(parser.add_pos("Command", VEX_ARG_TYPE_STR, "command", 1));
+	CHECK(parser.add_pos("Files", VEX_ARG_TYPE_STR, "files", -1));
+}
+
+static void test_lazy_parse() {
+	char* argv[] = { (char*)"app", (char*)"run", (char*)"-i", (char*)"1", (char*)"2", (char*)"-l", (char*)"3",
+		(char*)"-n", (char*)"x", (char*)"a.txt", (char*)"b.txt" };
+
+	// Slots and options arrive as soon as they're complete, the unbounded slot last
+	vex parser("app", "1.0", "Lazy test");
+	setup(parser);
+	std::vector<std::string> order;
+	for (const auto& token : parser.lazy_parse(11, argv)) {
+		if (token.is_pos()) order.push_back("pos" + std::to_string(token.slot) + ":" + token.value<std::string>(token.count() - 1));
+		else order.push_back(std::string(token.token->long_name) + ":" + std::to_string(token.count()));
+	}
+	std::vector<std::string> expected = { "pos0:run", "ids:2", "level:1", "name:1", "pos1:b.txt" };
+	CHECK(order == expected);
+	CHECK(parser.status() == VEX_STATUS_OK);
+
+	// After running to the end the parser holds what a full parse gives
+	vex full("app", "1.0", "Lazy test");
+	setup(full);
+	CHECK(full.parse(11, argv));
+	CHECK(parser.token_count() == full.token_count());
+	for (int i = 0; i < full.token_count(); ++i) {
+		CHECK(std::strcmp(parser.get_token(i)->long_name, full.get_token(i)->long_name) == 0);
+		CHECK(parser.get_token(i)->arg_count == full.get_token(i)->arg_count);
+	}
+	CHECK(parser.values<int>("ids").size() == 2 && parser.values<int>("ids")[1] == 2);
+	CHECK(parser.get_pos(1)->arg_count == 2);
+
+	// Stopping after the subcommand leaves the rest unread
+	vex early("app", "1.0", "Lazy test");
+	setup(early);
+	int seen = 0;
+	for (const auto& token : early.lazy_parse(11, argv)) {
+		seen++;
+		CHECK(token.is_pos() && token.slot == 0 && std::strcmp(token.value<const char*>(), "run") == 0);
+		break;
+	}
+	CHECK(seen == 1 && early.token_count() == 0);
+}
+
+int main() {
+	test_lazy_parse();
+	if (failures > 0) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	std::printf("All C++20 checks passed\n");
+	return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ test_getopt.c
+
+ Runs vex_getopt_long and the C library's getopt_long side by side over the same inputs, and checks they return the
+ same options, arguments and indices, and leave argv permuted the same way.
+ */
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+#define MAX_ARGS 32
+#define MAX_STEPS 64
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+typedef struct {
+	int ret;
+	int optind;
+	int optopt;
+	int longindex;
+	int flag;
+	const char* optarg;
+} step;
+
+typedef struct {
+	step steps[MAX_STEPS];
+	int num_steps;
+	int optind;
+	char* argv[MAX_ARGS];
+	char buffer[256];
+} trace;
+
+static int flag = 0;
+
+static const struct option libc_longopts[] = {
+	{ "verbose", no_argument, NULL, 'v' },
+	{ "output", required_argument, NULL, 'o' },
+	{ "color", optional_argument, NULL, 'c' },
+	{ "colour", optional_argument, NULL, 'c' },
+	{ "count", required_argument, NULL, 'n' },
+	{ "flag", no_argument, &flag, 42 },
+	{ "fast", no_argument, NULL, 'f' },
+	{ "file", required_argument, NULL, 'F' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static const vex_option vex_longopts[] = {
+	{ "verbose", VEX_NO_ARGUMENT, NULL, 'v' },
+	{ "output", VEX_REQUIRED_ARGUMENT, NULL, 'o' },
+	{ "color", VEX_OPTIONAL_ARGUMENT, NULL, 'c' },
+	{ "colour", VEX_OPTIONAL_ARGUMENT, NULL, 'c' },
+	{ "count", VEX_REQUIRED_ARGUMENT, NULL, 'n' },
+	{ "flag", VEX_NO_ARGUMENT, &flag, 42 },
+	{ "fast", VEX_NO_ARGUMENT, NULL, 'f' },
+	{ "file", VEX_REQUIRED_ARGUMENT, NULL, 'F' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static const char* optstrings[] = { "vo:c::n:fF:", "+vo:c::n:fF:", "-vo:c::n:fF:", ":vo:c::n:fF:", "vo:c::n:fF:W;", ":W;vo:" };
+
+static const char* cases[] = {
+	"",
+	"a -v b --output=x c -ofile -o y --color --color=red -c -cblue d",
+	"-vvv -- -v x",
+	"x y -v -- z",
+	"-x --unknown --verbose=1 --output",
+	"--co --col=1 --fl --f --fla -n",
+	"-vo",
+	"- -v -",
+	"--output -- -v",
+	"-v -n3 a -n 4 --count 5",
+	"--file=abc --fast -fv x -F",
+	"a b c --verbose d e -- f -v",
+	"-c x -c -o -v",
+	"--",
+	"--verb -vfo out file --cou=9 --fil name",
+	"-W verbose -Wout=x a -W col -Wcolor=red -W fil b -vW fast",
+	"-W nope -Wco -W flag -W verbose=1 -W output",
+	"x -W"
+};
+
+static int split(const char* line, char* buffer, char** argv) {
+	// Words separated by single spaces, after the program name
+	strcpy(buffer, line);
+	int argc = 0;
+	argv[argc++] = "prog";
+	for (char* word = strtok(buffer, " "); word; word = strtok(NULL, " ")) argv[argc++] = word;
+	argv[argc] = NULL;
+	return argc;
+}
+
+static void run_libc(const char* optstring, const char* line, trace* out) {
+	int argc = split(line, out->buffer, out->argv);
+	out->num_steps = 0;
+	optind = 0;
+	opterr = 0;
+	for (;;) {
+		step* st = &out->steps[out->num_steps++];
+		st->longindex = -1;
+		flag = 0;
+		st->ret = getopt_long(argc, out->argv, optstring, libc_longopts, &st->longindex);
+		st->optind = optind;
+		st->optopt = (st->ret == '?' || st->ret == ':') ? optopt : 0;
+		st->optarg = optarg;
+		st->flag = flag;
+		if (st->ret == -1 || out->num_steps == MAX_STEPS) break;
+	}
+	out->optind = optind;
+}
+
+static void run_vex(const char* optstring, const char* line, trace* out) {
+	int argc = split(line, out->buffer, out->argv);
+	out->num_steps = 0;
+	vex_getopt state;
+	vex_getopt_init(&state);
+	state.opterr = 0;
+	for (;;) {
+		step* st = &out->steps[out->num_steps++];
+		st->longindex = -1;
+		flag = 0;
+		st->ret = vex_getopt_long(&state, argc, out->argv, optstring, vex_longopts, &st->longindex);
+		st->optind = state.optind;
+		st->optopt = (st->ret == '?' || st->ret == ':') ? state.optopt : 0;
+		st->optarg = state.optarg;
+		st->flag = flag;
+		if (st->ret == -1 || out->num_steps == MAX_STEPS) break;
+	}
+	out->optind = state.optind;
+	vex_getopt_free(&state);
+}
+
+static bool same_str(const char* a, const char* b) {
+	if (!a || !b) return a == b;
+	return strcmp(a, b) == 0;
+}
+
+static void compare(const char* optstring, const char* line) {
+	trace expected, actual;
+	run_libc(optstring, line, &expected);
+	run_vex(optstring, line, &actual);
+
+	bool same = expected.num_steps == actual.num_steps && expected.optind == actual.optind;
+	for (int i = 0; same && i < expected.num_steps; ++i) {
+		const step* a = &expected.steps[i];
+		const step* b = &actual.steps[i];
+		same = a->ret == b->ret && a->optind == b->optind && a->optopt == b->optopt && a->longindex == b->longindex &&
+			a->flag == b->flag && same_str(a->optarg, b->optarg);
+	}
+	for (int a = 0; same && expected.argv[a]; ++a) same = same_str(expected.argv[a], actual.argv[a]);
+	if (!same) {
+		fprintf(stderr, "mismatch for \"%s\" with \"%s\"\n", optstring, line);
+		for (int i = 0; i < expected.num_steps || i < actual.num_steps; ++i) {
+			const step* a = &expected.steps[i];
+			const step* b = &actual.steps[i];
+			if (i < expected.num_steps) fprintf(stderr, "  libc ret=%d optind=%d optopt=%d longindex=%d optarg=%s\n", a->ret, a->optind, a->optopt, a->longindex, a->optarg ? a->optarg : "(null)");
+			if (i < actual.num_steps) fprintf(stderr, "  vex  ret=%d optind=%d optopt=%d longindex=%d optarg=%s\n", b->ret, b->optind, b->optopt, b->longindex, b->optarg ? b->optarg : "(null)");
+		}
+		failures++;
+	}
+}
+
+static void test_reentrant(void) {
+	// Two scans interleaved on separate states don't disturb each other
+	char* argv1[] = { "prog", "-v", "--output", "a", "x", NULL };
+	char* argv2[] = { "prog", "-n", "5", "--fast", NULL };
+	vex_getopt s1, s2;
+	vex_getopt_init(&s1);
+	vex_getopt_init(&s2);
+	CHECK(vex_getopt_long(&s1, 5, argv1, "vo:", vex_longopts, NULL) == 'v');
+	CHECK(vex_getopt_long(&s2, 4, argv2, "n:f", vex_longopts, NULL) == 'n');
+	CHECK(strcmp(s2.optarg, "5") == 0);
+	CHECK(vex_getopt_long(&s1, 5, argv1, "vo:", vex_longopts, NULL) == 'o');
+	CHECK(strcmp(s1.optarg, "a") == 0);
+	CHECK(vex_getopt_long(&s2, 4, argv2, "n:f", vex_longopts, NULL) == 'f');
+	CHECK(vex_getopt_long(&s1, 5, argv1, "vo:", vex_longopts, NULL) == -1);
+	CHECK(vex_getopt_long(&s2, 4, argv2, "n:f", vex_longopts, NULL) == -1);
+	CHECK(s1.optind == 4 && s2.optind == 4);
+
+	// Resetting optind rescans with the same tables
+	s1.optind = 0;
+	CHECK(vex_getopt_long(&s1, 5, argv1, "vo:", vex_longopts, NULL) == 'v');
+	vex_getopt_free(&s1);
+	vex_getopt_free(&s2);
+}
+
+int main(void) {
+	unsetenv("POSIXLY_CORRECT");
+	for (size_t o = 0; o < sizeof(optstrings) / sizeof(optstrings[0]); ++o) {
+		for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) compare(optstrings[o], cases[c]);
+	}
+	test_reentrant();
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All getopt checks passed\n");
+	return 0;
+}
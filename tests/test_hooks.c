@@ -0,0 +1,150 @@
+/*
+ test_hooks.c
+
+ Builds the parser with statistics and every trace hook enabled, then checks the counters and the order of the
+ traced events for known command lines.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_EVENTS 64
+
+static char events[MAX_EVENTS][64];
+static int num_events = 0;
+static unsigned long long traced_allocs = 0;
+static unsigned long long traced_bytes = 0;
+
+static void record(const char* kind, const char* what) {
+	if (num_events < MAX_EVENTS) snprintf(events[num_events++], sizeof(events[0]), "%s:%s", kind, what ? what : "");
+}
+
+static void record_error(int status) {
+	char text[16];
+	snprintf(text, sizeof(text), "%d", status);
+	record("error", text);
+}
+
+// Allocations happen all the time, so they're counted rather than logged
+#define VEX_ENABLE_STATS
+#define VEX_TRACE_OPTION_RESOLVED(ctx, long_name, short_name) record("option", long_name)
+#define VEX_TRACE_VALUE_CONVERTED(ctx, arg_type, str) record("value", str)
+#define VEX_TRACE_ALLOC(ctx, ptr, bytes) do { traced_allocs++; traced_bytes += (bytes); } while (0)
+#define VEX_TRACE_ERROR(ctx, status, msg) record_error(status)
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+static void add_option(vex_ctx* ctx, const char* name, char short_name, int type, int max_count) {
+	vex_arg_desc desc = { 0 };
+	desc.description = "Some option";
+	desc.long_name = (char*)name;
+	desc.short_name = short_name;
+	desc.arg_type = type;
+	desc.max_count = max_count;
+	CHECK(vex_add_arg(ctx, desc));
+}
+
+static void setup(vex_ctx* ctx) {
+	vex_init_info info = { "app", "1.0", "Hook test", 0 };
+	CHECK(vex_init(ctx, info));
+	add_option(ctx, "quiet", 'q', VEX_ARG_TYPE_FLAG, 0);
+	add_option(ctx, "level", 'l', VEX_ARG_TYPE_INT, 1);
+	add_option(ctx, "name", 'n', VEX_ARG_TYPE_STR, -1);
+	vex_pos_desc pos = { 0 };
+	pos.description = "Some positional";
+	pos.name = "out";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	pos.max_count = 1;
+	CHECK(vex_add_pos(ctx, pos));
+}
+
+static bool same_events(const char* const* expected, int count) {
+	bool same = (num_events == count);
+	for (int i = 0; same && i < count; ++i) same = (strcmp(events[i], expected[i]) == 0);
+	if (!same) {
+		fprintf(stderr, "traced:");
+		for (int i = 0; i < num_events; ++i) fprintf(stderr, " %s", events[i]);
+		fprintf(stderr, "\n");
+	}
+	return same;
+}
+
+static void reset_hooks(vex_ctx* ctx) {
+	vex_reset_stats(ctx);
+	num_events = 0;
+	traced_allocs = 0;
+	traced_bytes = 0;
+}
+
+static void test_stats(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char* argv[] = { "app", "-q", "out.txt", "--level=3", "-n", "a", "b" };
+
+	// Every traced allocation is counted, and each argument is scanned once
+	reset_hooks(&ctx);
+	CHECK(vex_parse(&ctx, 7, argv));
+	vex_stats stats;
+	CHECK(vex_get_stats(&ctx, &stats));
+	CHECK(stats.args_scanned == 6);
+	CHECK(stats.lookup_probes >= 3);
+	CHECK(stats.peak_tokens == 3);
+	CHECK(stats.peak_values == 2);
+	CHECK(stats.allocs == traced_allocs);
+	CHECK(stats.alloc_bytes == traced_bytes);
+
+	// Counters accumulate across parses until reset
+	CHECK(vex_parse(&ctx, 7, argv));
+	vex_stats again;
+	CHECK(vex_get_stats(&ctx, &again));
+	CHECK(again.args_scanned == 12);
+	CHECK(again.lookup_probes == 2 * stats.lookup_probes);
+	CHECK(again.allocs == traced_allocs);
+	vex_reset_stats(&ctx);
+	CHECK(vex_get_stats(&ctx, &again));
+	CHECK(again.args_scanned == 0 && again.lookup_probes == 0 && again.allocs == 0 && again.peak_tokens == 0);
+	vex_free(&ctx);
+}
+
+static void test_trace(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+
+	// Options are traced as they're resolved and values as they're stored, in command line order
+	reset_hooks(&ctx);
+	char* argv[] = { "app", "-q", "out.txt", "--level=3", "-n", "a", "b" };
+	CHECK(vex_parse(&ctx, 7, argv));
+	const char* expected[] = { "option:quiet", "value:out.txt", "option:level", "value:3", "option:name", "value:a", "value:b" };
+	CHECK(same_events(expected, 7));
+
+	// A failed parse ends with its error, and nothing after the bad argument is traced
+	reset_hooks(&ctx);
+	char* bad[] = { "app", "-l", "2", "-z", "-q" };
+	CHECK(!vex_parse(&ctx, 5, bad));
+	char error[32];
+	snprintf(error, sizeof(error), "error:%d", ctx.status);
+	const char* expected_bad[] = { "option:level", "value:2", error };
+	CHECK(same_events(expected_bad, 3));
+	vex_free(&ctx);
+}
+
+int main(void) {
+	test_stats();
+	test_trace();
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All hook checks passed\n");
+	return 0;
+}
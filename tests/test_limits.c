@@ -0,0 +1,240 @@
+/*
+ test_limits.c
+
+ Checks that input limits are enforced with VEX_STATUS_LIMIT_EXCEEDED, and that hostile input shapes take time
+ linear in their size: each case is timed at two sizes and must not grow much faster than the input.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+// Input is scaled by SCALE between the two runs; linear work grows by about SCALE, quadratic by SCALE squared
+#define SCALE 8
+#define MAX_GROWTH 24.0
+
+typedef struct {
+	char** argv;
+	int argc;
+	char* str;
+} input;
+
+typedef void (*build_fn)(input* in, int n);
+
+static void setup(vex_ctx* ctx, int flags) {
+	vex_init_info info = { "app", "1.0", "Limit test", flags };
+	CHECK(vex_init(ctx, info));
+
+	vex_arg_desc desc = { 0 };
+	desc.description = "Input file";
+	desc.long_name = "input";
+	desc.short_name = 'i';
+	desc.arg_type = VEX_ARG_TYPE_STR;
+	desc.max_count = -1;
+	CHECK(vex_add_arg(ctx, desc));
+	desc.description = "Be verbose";
+	desc.long_name = "verbose";
+	desc.short_name = 'V';
+	desc.arg_type = VEX_ARG_TYPE_FLAG;
+	desc.max_count = 0;
+	CHECK(vex_add_arg(ctx, desc));
+
+	vex_pos_desc pos = { 0 };
+	pos.description = "Numbers";
+	pos.name = "numbers";
+	pos.arg_type = VEX_ARG_TYPE_INT;
+	pos.max_count = 3;
+	CHECK(vex_add_pos(ctx, pos));
+}
+
+static char** alloc_argv(int argc) {
+	char** argv = (char**)calloc((size_t)argc + 1, sizeof(*argv));
+	if (!argv) exit(1);
+	argv[0] = "app";
+	return argv;
+}
+
+static char* alloc_str(size_t len, char fill) {
+	char* str = (char*)malloc(len + 1);
+	if (!str) exit(1);
+	memset(str, fill, len);
+	str[len] = '\0';
+	return str;
+}
+
+static void build_many_values(input* in, int n) {
+	// One option collecting every value
+	in->argc = n + 2;
+	in->argv = alloc_argv(in->argc);
+	in->argv[1] = "-i";
+	for (int a = 2; a < in->argc; ++a) in->argv[a] = "value";
+}
+
+static void build_long_value(input* in, int n) {
+	// A single huge --option=value
+	in->argc = 2;
+	in->argv = alloc_argv(in->argc);
+	in->str = alloc_str((size_t)n * 16, 'x');
+	memcpy(in->str, "--input=", 8);
+	in->argv[1] = in->str;
+}
+
+static void build_flag_cluster(input* in, int n) {
+	// -VVVV... with one token per character
+	in->argc = 2;
+	in->argv = alloc_argv(in->argc);
+	in->str = alloc_str((size_t)n, 'V');
+	in->str[0] = '-';
+	in->argv[1] = in->str;
+}
+
+static void build_unknown(input* in, int n) {
+	// Unknown options interleaved with values, all forwarded
+	in->argc = n + 1;
+	in->argv = alloc_argv(in->argc);
+	for (int a = 1; a < in->argc; ++a) in->argv[a] = (a % 2) ? "--unknown" : "-V";
+}
+
+static void build_quoted_string(input* in, int n) {
+	// A command string of escaped and quoted words for vex_parse_string
+	in->argc = 0;
+	in->str = alloc_str((size_t)n * 8, ' ');
+	for (int i = 0; i < n; ++i) memcpy(&in->str[i * 8], (i == 0) ? "-i 'a'\\ " : "\"b\\\"cd\" ", 8);
+}
+
+static double time_parse(build_fn build, int n, int flags) {
+	// Best of a few runs to keep noise down
+	double best = 1e30;
+	for (int run = 0; run < 3; ++run) {
+		vex_ctx ctx;
+		setup(&ctx, flags);
+		input in;
+		memset(&in, 0, sizeof(in));
+		build(&in, n);
+		char* copy = in.str ? alloc_str(strlen(in.str), ' ') : NULL;
+		if (copy) strcpy(copy, in.str);
+
+		clock_t start = clock();
+		bool ok = in.argv ? vex_parse(&ctx, in.argc, in.argv) : vex_parse_string(&ctx, copy);
+		double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+		CHECK(ok);
+		if (elapsed < best) best = elapsed;
+
+		vex_free(&ctx);
+		free(in.argv);
+		free(in.str);
+		free(copy);
+	}
+	return best;
+}
+
+static void check_linear(const char* name, build_fn build, int n, int flags) {
+	double small = time_parse(build, n, flags);
+	double large = time_parse(build, n * SCALE, flags);
+
+	// Very fast runs are dominated by timer resolution, give them a floor
+	double floor = 0.001;
+	double growth = (large < floor ? floor : large) / (small < floor ? floor : small);
+	if (growth > MAX_GROWTH) {
+		fprintf(stderr, "%s: %d -> %d grew %.1fx (%.4fs -> %.4fs)\n", name, n, n * SCALE, growth, small, large);
+		failures++;
+	}
+}
+
+static void test_limits(void) {
+	vex_ctx ctx;
+	setup(&ctx, VEX_FLAG_PASS_REMAINDER);
+	char* argv[] = { "app", "-i", "a", "b", "c", "-V", "1", "--", "x", "y" };
+	CHECK(vex_parse(&ctx, 10, argv));
+
+	// Argument count, including pass-through
+	vex_limits limits = { 0 };
+	limits.max_args = 8;
+	vex_set_limits(&ctx, limits);
+	CHECK(!vex_parse(&ctx, 10, argv));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+	limits.max_args = 9;
+	vex_set_limits(&ctx, limits);
+	CHECK(vex_parse(&ctx, 10, argv));
+
+	// Values per option and per positional
+	memset(&limits, 0, sizeof(limits));
+	limits.max_values = 2;
+	vex_set_limits(&ctx, limits);
+	CHECK(!vex_parse(&ctx, 10, argv));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+	char* numbers[] = { "app", "1", "2", "3" };
+	CHECK(!vex_parse(&ctx, 4, numbers));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+	CHECK(vex_parse(&ctx, 3, numbers));
+
+	// Length of one argument
+	memset(&limits, 0, sizeof(limits));
+	limits.max_arg_len = 4;
+	vex_set_limits(&ctx, limits);
+	char* long_arg[] = { "app", "--input=abc" };
+	CHECK(!vex_parse(&ctx, 2, long_arg));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+	CHECK(vex_parse(&ctx, 3, argv));
+
+	// Total bytes, counting each argument's terminator
+	memset(&limits, 0, sizeof(limits));
+	limits.max_total_bytes = 8;
+	vex_set_limits(&ctx, limits);
+	CHECK(vex_parse(&ctx, 4, argv));
+	CHECK(!vex_parse(&ctx, 5, argv));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+
+	// Command strings are limited the same way
+	char str[] = "-i a b c";
+	memset(&limits, 0, sizeof(limits));
+	limits.max_args = 3;
+	vex_set_limits(&ctx, limits);
+	CHECK(!vex_parse_string(&ctx, str));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+
+	// A prefix counts towards its suffixes
+	vex_checkpoint checkpoint;
+	char* suffix[] = { "x", "y" };
+	CHECK(vex_parse_prefix(&ctx, 3, argv, &checkpoint));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 1, suffix));
+	CHECK(!vex_parse_suffix(&ctx, &checkpoint, 2, suffix));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+
+	// No limits again
+	memset(&limits, 0, sizeof(limits));
+	vex_set_limits(&ctx, limits);
+	CHECK(vex_parse(&ctx, 10, argv));
+	vex_free(&ctx);
+}
+
+static void test_linear_time(void) {
+	check_linear("many values", build_many_values, 40000, 0);
+	check_linear("long value", build_long_value, 40000, 0);
+	check_linear("flag cluster", build_flag_cluster, 40000, 0);
+	check_linear("unknown options", build_unknown, 40000, VEX_FLAG_PASS_UNKNOWN);
+	check_linear("quoted string", build_quoted_string, 40000, 0);
+}
+
+int main(void) {
+	test_limits();
+	test_linear_time();
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All limit checks passed\n");
+	return 0;
+}
@@ -0,0 +1,608 @@
+/*
+ test_parse.c
+
+ Checks what a parse produces from known command lines: typed positional slots and the errors they raise, the
+ order argv is left in when arguments are forwarded, that rendered command lines parse back to the same result,
+ which command lines share a canonical hash, that packed results survive being moved to another buffer, how
+ strings and doubles are written as JSON, when a parse stream hands out each token, how command strings split
+ into words, and which option a long or short name resolves to.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+static void add_option(vex_ctx* ctx, const char* name, char short_name, int type, int max_count) {
+	vex_arg_desc desc = { 0 };
+	desc.description = "Some option";
+	desc.long_name = (char*)name;
+	desc.short_name = short_name;
+	desc.arg_type = type;
+	desc.max_count = max_count;
+	CHECK(vex_add_arg(ctx, desc));
+}
+
+static void add_pos(vex_ctx* ctx, const char* name, int type, int max_count) {
+	vex_pos_desc pos = { 0 };
+	pos.description = "Some positional";
+	pos.name = (char*)name;
+	pos.arg_type = type;
+	pos.max_count = max_count;
+	CHECK(vex_add_pos(ctx, pos));
+}
+
+static void test_positionals(void) {
+	vex_ctx ctx;
+	vex_init_info info = { "app", "1.0", "Parse test", 0 };
+	CHECK(vex_init(&ctx, info));
+	add_option(&ctx, "quiet", 'q', VEX_ARG_TYPE_FLAG, 0);
+	add_pos(&ctx, "name", VEX_ARG_TYPE_STR, 1);
+	add_pos(&ctx, "count", VEX_ARG_TYPE_INT, 1);
+	add_pos(&ctx, "scales", VEX_ARG_TYPE_DUB, 2);
+
+	// Slots convert by their declared type, so a numeric name stays a string; what's left over becomes tokens
+	char* argv[] = { "app", "2024", "-q", "17", "1.5", "2e3", "extra" };
+	CHECK(vex_parse(&ctx, 7, argv));
+	CHECK(vex_pos_count(&ctx) == 3);
+	CHECK(vex_get_pos(&ctx, 0)->arg_count == 1 && strcmp(vex_get_pos(&ctx, 0)->arg[0].str_arg, "2024") == 0);
+	CHECK(vex_get_pos(&ctx, 1)->arg[0].int_arg == 17);
+	CHECK(vex_get_pos(&ctx, 2)->arg_count == 2 && vex_get_pos(&ctx, 2)->arg[1].dub_arg == 2000.0);
+	CHECK(vex_token_count(&ctx) == 2);
+	CHECK(strcmp(vex_get_token(&ctx, 1)->arg[0].str_arg, "extra") == 0);
+
+	// Values the slot type can't hold; negative numbers need a "--" so they aren't taken for options
+	const char* bad[] = { "12abc", "", "2147483648", "-2147483649", "99999999999999999999" };
+	for (int i = 0; i < 5; ++i) {
+		char* bad_argv[] = { "app", "--", "x", (char*)bad[i] };
+		CHECK(!vex_parse(&ctx, 4, bad_argv));
+		CHECK(ctx.status == VEX_STATUS_BAD_VALUE);
+		CHECK(strncmp(ctx.status_msg, "Invalid value for count: ", 25) == 0);
+	}
+	char* bad_dub[] = { "app", "x", "1", "1.5x" };
+	CHECK(!vex_parse(&ctx, 4, bad_dub));
+	CHECK(ctx.status == VEX_STATUS_BAD_VALUE);
+	char* limits[] = { "app", "--", "x", "-2147483648" };
+	CHECK(vex_parse(&ctx, 4, limits));
+	CHECK(vex_get_pos(&ctx, 1)->arg[0].int_arg == INT_MIN);
+	vex_free(&ctx);
+}
+
+static void check_argv(char** argv, const char** expected, int count) {
+	for (int i = 0; i < count; ++i) {
+		if (strcmp(argv[i], expected[i]) != 0) {
+			fprintf(stderr, "argv[%d]: expected %s, got %s\n", i, expected[i], argv[i]);
+			failures++;
+		}
+	}
+}
+
+static void setup_pass(vex_ctx* ctx, int flags) {
+	vex_init_info info = { "app", "1.0", "Pass-through test", flags };
+	CHECK(vex_init(ctx, info));
+	add_option(ctx, "all", 'a', VEX_ARG_TYPE_FLAG, 0);
+	add_option(ctx, "brief", 'b', VEX_ARG_TYPE_FLAG, 0);
+	add_option(ctx, "global", 'g', VEX_ARG_TYPE_FLAG, 0);
+	add_option(ctx, "num", 'n', VEX_ARG_TYPE_INT, 1);
+}
+
+static void test_passthrough(void) {
+	// Forwarded options move to the end, and both sides keep their order
+	vex_ctx ctx;
+	setup_pass(&ctx, VEX_FLAG_PASS_UNKNOWN);
+	char* argv[] = { "app", "--unk1", "-a", "-b", "-g", "--unk2", "-x", "-n", "3", NULL };
+	const char* expected[] = { "app", "-a", "-b", "-g", "-n", "3", "--unk1", "--unk2", "-x" };
+	CHECK(vex_parse(&ctx, 9, argv));
+	check_argv(argv, expected, 9);
+	int count = 0;
+	char** pass = vex_get_passthrough(&ctx, &count);
+	CHECK(count == 3 && pass == &argv[6] && pass[3] == NULL);
+
+	// Nothing moves when the parse fails
+	char* bad[] = { "app", "--unk1", "-a", "-az", "--unk2" };
+	const char* bad_expected[] = { "app", "--unk1", "-a", "-az", "--unk2" };
+	CHECK(!vex_parse(&ctx, 5, bad));
+	check_argv(bad, bad_expected, 5);
+	vex_free(&ctx);
+
+	// The separator leads the remainder, so the slice parses the same way again
+	setup_pass(&ctx, VEX_FLAG_PASS_UNKNOWN | VEX_FLAG_PASS_REMAINDER);
+	char* mixed[] = { "app", "--unk1", "-b", "-x", "x", "-a", "--", "y", "-g", NULL };
+	const char* mixed_expected[] = { "app", "-b", "x", "-a", "--unk1", "-x", "--", "y", "-g" };
+	CHECK(vex_parse(&ctx, 9, mixed));
+	check_argv(mixed, mixed_expected, 9);
+	pass = vex_get_passthrough(&ctx, &count);
+	CHECK(count == 5 && pass == &mixed[4] && pass[5] == NULL);
+	CHECK(vex_token_count(&ctx) == 3);
+
+	char* child[6] = { "child" };
+	for (int i = 0; i < count; ++i) child[i + 1] = pass[i];
+	const char* child_expected[] = { "child", "--unk1", "-x", "--", "y", "-g" };
+	CHECK(vex_parse(&ctx, 6, child));
+	CHECK(vex_token_count(&ctx) == 0);
+	pass = vex_get_passthrough(&ctx, &count);
+	CHECK(count == 5);
+	check_argv(child, child_expected, 6);
+
+	// Only the remainder leaves argv as it was
+	char* remainder[] = { "app", "-a", "--", "-b" };
+	const char* remainder_expected[] = { "app", "-a", "--", "-b" };
+	CHECK(vex_parse(&ctx, 4, remainder));
+	check_argv(remainder, remainder_expected, 4);
+	pass = vex_get_passthrough(&ctx, &count);
+	CHECK(count == 2 && pass == &remainder[2]);
+
+	// A prefix may end with the separator, the suffix is then forwarded whole
+	vex_checkpoint checkpoint;
+	char* prefix[] = { "app", "-a", "--" };
+	char* suffix[] = { "ls", "-l" };
+	CHECK(vex_parse_prefix(&ctx, 3, prefix, &checkpoint));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 2, suffix));
+	pass = vex_get_passthrough(&ctx, &count);
+	CHECK(count == 2 && pass == suffix);
+	char* forwarded_prefix[] = { "app", "--unk1", "--" };
+	CHECK(!vex_parse_prefix(&ctx, 3, forwarded_prefix, &checkpoint));
+	vex_free(&ctx);
+}
+
+static bool same_str(const char* a, const char* b) {
+	if (!a || !b) return a == b;
+	return strcmp(a, b) == 0;
+}
+
+static bool same_tokens(const vex_arg_token* a, const vex_arg_token* b, int count) {
+	for (int i = 0; i < count; ++i) {
+		if (a[i].short_name != b[i].short_name || !same_str(a[i].long_name, b[i].long_name)) return false;
+		if (a[i].arg_type != b[i].arg_type || a[i].arg_count != b[i].arg_count) return false;
+		for (int j = 0; j < a[i].arg_count; ++j) {
+			vex_value x = a[i].arg[j], y = b[i].arg[j];
+			if (a[i].arg_type == VEX_ARG_TYPE_STR && !same_str(x.str_arg, y.str_arg)) return false;
+			if (a[i].arg_type == VEX_ARG_TYPE_INT && x.int_arg != y.int_arg) return false;
+			if (a[i].arg_type == VEX_ARG_TYPE_DUB && x.dub_arg != y.dub_arg) return false;
+		}
+	}
+	return true;
+}
+
+static bool same_result(vex_ctx* a, vex_ctx* b) {
+	vex_result x, y;
+	vex_get_result(a, &x);
+	vex_get_result(b, &y);
+	if (x.num_arg_token != y.num_arg_token || x.num_pos_token != y.num_pos_token || x.pass_argc != y.pass_argc) return false;
+	if (!same_tokens(x.arg_token, y.arg_token, x.num_arg_token) || !same_tokens(x.pos_token, y.pos_token, x.num_pos_token)) return false;
+	for (int i = 0; i < x.pass_argc; ++i) {
+		if (!same_str(x.pass_argv[i], y.pass_argv[i])) return false;
+	}
+	return true;
+}
+
+static void setup_render(vex_ctx* ctx, int flags) {
+	vex_init_info info = { "app", "1.0", "Render test", flags };
+	CHECK(vex_init(ctx, info));
+	add_option(ctx, "input", 'i', VEX_ARG_TYPE_STR, -1);
+	add_option(ctx, "level", 'l', VEX_ARG_TYPE_INT, 1);
+	add_option(ctx, "scale", 's', VEX_ARG_TYPE_DUB, 1);
+	add_option(ctx, "quiet", 'q', VEX_ARG_TYPE_FLAG, 0);
+	add_pos(ctx, "out", VEX_ARG_TYPE_STR, 1);
+	add_pos(ctx, "nums", VEX_ARG_TYPE_INT, -1);
+}
+
+static void round_trip(int flags, int argc, char** argv, bool cmdline) {
+	// Parse, render, and parse the rendering again on a second context with the same schema
+	vex_ctx a, b;
+	setup_render(&a, flags);
+	setup_render(&b, flags);
+	CHECK(vex_parse(&a, argc, argv));
+	int child_argc = 0;
+	char** child = vex_build_argv(&a, "app", NULL, 0, &child_argc);
+	CHECK(child != NULL);
+	if (child) {
+		CHECK(vex_parse(&b, child_argc, child));
+		if (!same_result(&a, &b)) {
+			fprintf(stderr, "argv round trip differs for:");
+			for (int i = 0; i < child_argc; ++i) fprintf(stderr, " [%s]", child[i]);
+			fprintf(stderr, "\n");
+			failures++;
+		}
+	}
+
+	// The shell quoted form goes through the tokenizer instead, which has no program name
+	char* line = cmdline ? vex_build_cmdline(&a, "app", NULL, 0) : NULL;
+	if (line) {
+		CHECK(strncmp(line, "app ", 4) == 0);
+		CHECK(vex_parse_string(&b, line + 4));
+		if (!same_result(&a, &b)) {
+			fprintf(stderr, "command line round trip differs for: %s\n", line);
+			failures++;
+		}
+	}
+	vex_free_buffer(line);
+	vex_free_buffer(child);
+	vex_free(&a);
+	vex_free(&b);
+}
+
+static void test_render(void) {
+	// Values that need quoting: spaces, both kinds of quote, backslashes and shell syntax
+	char* quoting[] = { "app", "out dir/x.txt", "-i", "a b.txt", "it's", "say \"hi\"", "back\\slash", "$HOME;`ls`",
+		"--level=3", "-s", "0.1", "-q", "1", "2" };
+	round_trip(0, 14, quoting, true);
+
+	// Positionals that look like options go after a "--"
+	char* late[] = { "app", "-q", "--", "-o.txt", "-5", "7" };
+	round_trip(0, 6, late, true);
+	round_trip(VEX_FLAG_PASS_UNKNOWN, 6, late, true);
+	char* late_forwarded[] = { "app", "--unk", "-q", "--", "-o.txt" };
+	round_trip(VEX_FLAG_PASS_UNKNOWN, 5, late_forwarded, false);
+
+	// Forwarded options and the remainder come back in the same slice
+	char* forwarded[] = { "app", "--unk", "-q", "out", "-x", "--", "ls", "-l" };
+	round_trip(VEX_FLAG_PASS_UNKNOWN | VEX_FLAG_PASS_REMAINDER, 8, forwarded, false);
+	char* remainder[] = { "app", "out", "-i", "a", "--", "--", "x" };
+	round_trip(VEX_FLAG_PASS_REMAINDER, 7, remainder, false);
+
+	// Where a "--" would start the pass-through they can't be rendered at all; only a command string gets them there
+	vex_ctx ctx;
+	setup_render(&ctx, VEX_FLAG_PASS_REMAINDER);
+	char line[] = "-q -- -o.txt";
+	CHECK(vex_parse_string(&ctx, line));
+	CHECK(vex_build_argv(&ctx, "app", NULL, 0, NULL) == NULL);
+	CHECK(ctx.status == VEX_STATUS_BAD_VALUE);
+	vex_free(&ctx);
+
+	// Slot tokens copied out by the cache have their own names, and still render as positionals
+	setup_render(&ctx, 0);
+	vex_cache cache;
+	CHECK(vex_cache_init(&cache, 4));
+	char* argv[] = { "app", "out.txt", "3", "-i", "a" };
+	const vex_result* result = vex_cache_parse(&cache, &ctx, 5, argv);
+	CHECK(result != NULL && result->num_pos_token == 2);
+	if (result) {
+		vex_arg_token tokens[4];
+		int num_tokens = 0;
+		for (int i = 0; i < result->num_pos_token; ++i) tokens[num_tokens++] = result->pos_token[i];
+		for (int i = 0; i < result->num_arg_token; ++i) tokens[num_tokens++] = result->arg_token[i];
+		CHECK(tokens[0].long_name != ctx.pos_desc[0].name);
+		int child_argc = 0;
+		char** child = vex_build_argv(&ctx, "app", tokens, num_tokens, &child_argc);
+		const char* expected[] = { "app", "out.txt", "3", "--input=a" };
+		CHECK(child != NULL && child_argc == 4);
+		if (child) check_argv(child, expected, 4);
+		vex_free_buffer(child);
+	}
+	vex_cache_free(&cache);
+	vex_free(&ctx);
+}
+
+static bool same_packed(const vex_packed_result* packed, const vex_packed_token* token, const vex_arg_token* expected) {
+	// A packed token holds the same name, type and values as the token it came from
+	if (!token) return false;
+	const char* long_name = vex_packed_get_str(packed, token->long_name);
+	if (!long_name || strcmp(long_name, expected->long_name) != 0) return false;
+	if (token->short_name != expected->short_name || token->arg_type != expected->arg_type || token->arg_count != expected->arg_count) return false;
+	const vex_packed_value* values = vex_packed_get_values(packed, token);
+	for (int i = 0; i < token->arg_count; ++i) {
+		if (token->arg_type == VEX_ARG_TYPE_INT && values[i].int_arg != expected->arg[i].int_arg) return false;
+		if (token->arg_type == VEX_ARG_TYPE_DUB && values[i].dub_arg != expected->arg[i].dub_arg) return false;
+		if (token->arg_type == VEX_ARG_TYPE_STR && !same_str(vex_packed_get_str(packed, values[i].str_arg), expected->arg[i].str_arg)) return false;
+	}
+	return true;
+}
+
+static void test_pack(void) {
+	vex_ctx ctx;
+	setup_render(&ctx, VEX_FLAG_PASS_UNKNOWN | VEX_FLAG_PASS_REMAINDER);
+	char* argv[] = { "app", "out.txt", "4", "5", "-i", "a b", "--unk", "--level=3", "-s", "0.5", "-q", "-i", "c", "--", "ls", "-l" };
+	CHECK(vex_parse(&ctx, 16, argv));
+	vex_result result;
+	vex_get_result(&ctx, &result);
+
+	// Pack, then move the bytes somewhere else and drop the original buffer
+	size_t size = vex_result_pack(&result, NULL, 0);
+	CHECK(size > 0 && size % 8 == 0);
+	uint64_t* first = (uint64_t*)malloc(size);
+	uint64_t* second = (uint64_t*)malloc(size);
+	CHECK(first && second);
+	if (!first || !second) return;
+	CHECK(vex_result_pack(&result, first, size) == size);
+	memcpy(second, first, size);
+	memset(first, 0xAB, size);
+	free(first);
+
+	// Reopened elsewhere, everything reads back the same
+	const vex_packed_result* packed = vex_packed_open(second, size);
+	CHECK(packed != NULL);
+	if (packed) {
+		CHECK(packed->num_arg_token == result.num_arg_token);
+		CHECK(packed->num_pos_token == result.num_pos_token);
+		for (int i = 0; i < result.num_arg_token; ++i) CHECK(same_packed(packed, vex_packed_get_token(packed, i), &result.arg_token[i]));
+		for (int i = 0; i < result.num_pos_token; ++i) CHECK(same_packed(packed, vex_packed_get_pos(packed, i), &result.pos_token[i]));
+		CHECK(packed->pass_argc == result.pass_argc);
+		for (int i = 0; i < result.pass_argc; ++i) CHECK(same_str(vex_packed_get_passthrough(packed, i), result.pass_argv[i]));
+		CHECK(vex_packed_arg_found(packed, "input") && vex_packed_arg_found(packed, "q") && !vex_packed_arg_found(packed, "unk"));
+	}
+
+	// A short or misaligned buffer doesn't open
+	CHECK(vex_packed_open(second, size - 8) == NULL);
+	CHECK(vex_packed_open((char*)second + 4, size - 4) == NULL);
+	free(second);
+	vex_free(&ctx);
+}
+
+static bool json_is(const vex_result* result, const char* expected) {
+	char buffer[512];
+	vex_json_writer writer;
+	vex_json_init_buffer(&writer, buffer, sizeof(buffer) - 1);
+	if (!vex_json_write(&writer, result, 0)) return false;
+	buffer[writer.len] = '\0';
+	if (strcmp(buffer, expected) == 0) return true;
+	fprintf(stderr, "got:      %s\nexpected: %s\n", buffer, expected);
+	return false;
+}
+
+static void test_json(void) {
+	// Control characters, quotes and backslashes are escaped, valid UTF-8 is copied, and stray bytes become U+FFFD
+	vex_value strs[4];
+	strs[0].str_arg = "a\"b\\c\n\t\x01";
+	strs[1].str_arg = "caf\xc3\xa9 \xe2\x82\xac";
+	strs[2].str_arg = "x\xffy\xc3";
+	strs[3].str_arg = "\xed\xa0\x80z";
+	vex_arg_token str_token = { "name", 'n', strs, 4, VEX_ARG_TYPE_STR, 4 };
+	vex_result result = { &str_token, 1, NULL, 0, NULL, 0 };
+	CHECK(json_is(&result, "{\"tokens\":[{\"short\":\"n\",\"long\":\"name\",\"type\":\"string\",\"values\":["
+		"\"a\\\"b\\\\c\\n\\t\\u0001\",\"caf\xc3\xa9 \xe2\x82\xac\",\"x\\ufffdy\\ufffd\",\"\\ufffd\\ufffd\\ufffdz\"]}],"
+		"\"positionals\":[],\"passthrough\":[]}"));
+
+	// JSON has no infinities or NaN
+	vex_value dubs[4];
+	dubs[0].dub_arg = 0.5;
+	dubs[1].dub_arg = HUGE_VAL;
+	dubs[2].dub_arg = -HUGE_VAL;
+	dubs[3].dub_arg = HUGE_VAL - HUGE_VAL;
+	vex_arg_token dub_token = { "scale", '\0', dubs, 4, VEX_ARG_TYPE_DUB, 4 };
+	char* pass[] = { "\x80" };
+	vex_result dub_result = { NULL, 0, &dub_token, 1, pass, 1 };
+	CHECK(json_is(&dub_result, "{\"tokens\":[],\"positionals\":[{\"name\":\"scale\",\"type\":\"double\",\"values\":[0.5,null,null,null]}],"
+		"\"passthrough\":[\"\\ufffd\"]}"));
+}
+
+static void test_stream(void) {
+	// Each token is handed out as soon as nothing more can be added to it, and the context ends up as vex_parse leaves it
+	vex_ctx a, b;
+	int flags = VEX_FLAG_PASS_UNKNOWN | VEX_FLAG_PASS_REMAINDER;
+	setup_render(&a, flags);
+	setup_render(&b, flags);
+	char* argv[] = { "app", "out.txt", "-i", "a", "b", "-l", "3", "-q", "4", "5", "--", "ls" };
+	char* copy[] = { "app", "out.txt", "-i", "a", "b", "-l", "3", "-q", "4", "5", "--", "ls" };
+	CHECK(vex_parse(&b, 12, copy));
+
+	vex_stream stream;
+	vex_stream_begin(&a, &stream, 12, argv);
+	int slot = -2;
+	const vex_arg_token* token = vex_stream_next(&a, &stream, &slot);
+
+	// A single value slot is full after its value
+	CHECK(token != NULL && slot == 0 && token->arg_count == 1 && stream.next_arg == 2);
+
+	// An unbounded option only closes when the next option starts
+	token = vex_stream_next(&a, &stream, &slot);
+	CHECK(token != NULL && slot == -1 && token->short_name == 'i' && token->arg_count == 2 && stream.next_arg == 6);
+
+	// An option closes as soon as it holds max_count values, a flag right away
+	token = vex_stream_next(&a, &stream, &slot);
+	CHECK(token != NULL && slot == -1 && token->short_name == 'l' && token->arg_count == 1 && stream.next_arg == 7);
+	token = vex_stream_next(&a, &stream, &slot);
+	CHECK(token != NULL && slot == -1 && token->short_name == 'q' && stream.next_arg == 8);
+
+	// An unbounded slot is only complete at the end, and the pass-through only arrives once the stream runs out
+	CHECK(a.pass_argc == 0);
+	token = vex_stream_next(&a, &stream, &slot);
+	CHECK(token != NULL && slot == 1 && token->arg_count == 2 && token->arg[1].int_arg == 5);
+	CHECK(vex_stream_next(&a, &stream, &slot) == NULL && a.status == VEX_STATUS_OK);
+	CHECK(a.pass_argc == 2 && strcmp(a.pass_argv[0], "--") == 0 && strcmp(a.pass_argv[1], "ls") == 0);
+	CHECK(same_result(&a, &b));
+	CHECK(vex_stream_next(&a, &stream, &slot) == NULL);
+
+	// Stopping early leaves the rest of argv unread
+	char* early[] = { "app", "out.txt", "-i", "a", "--unk", "--", "ls" };
+	vex_stream_begin(&a, &stream, 7, early);
+	token = vex_stream_next(&a, &stream, &slot);
+	CHECK(token != NULL && slot == 0 && stream.next_arg == 2);
+	CHECK(a.num_arg_token == 0 && a.pass_argc == 0);
+
+	// Any other parse makes the stream stale
+	CHECK(vex_parse(&a, 12, argv));
+	CHECK(vex_stream_next(&a, &stream, &slot) == NULL);
+	CHECK(a.status == VEX_STATUS_BAD_VALUE && a.status_msg && strcmp(a.status_msg, "Stale parse stream") == 0);
+
+	// A bad argument ends the stream with the parse error
+	char* bad[] = { "app", "-l", "3", "-s", "abc" };
+	vex_stream_begin(&a, &stream, 5, bad);
+	token = vex_stream_next(&a, &stream, &slot);
+	CHECK(token != NULL && token->short_name == 'l');
+	CHECK(vex_stream_next(&a, &stream, &slot) == NULL && a.status != VEX_STATUS_OK);
+	vex_free(&a);
+	vex_free(&b);
+}
+
+static void test_words(void) {
+	// A backslash-newline joins lines: inside a word it disappears, between words it's no word at all
+	vex_ctx ctx;
+	setup_render(&ctx, 0);
+	char line[] = "\\\n out\\\n.txt -i a \\\n b 'x\\\ny' \\\n\\\n -q \\\n";
+	CHECK(vex_parse_string(&ctx, line));
+	CHECK(ctx.num_arg_token == 2);
+	vex_arg_token* input = vex_get_token(&ctx, 0);
+	CHECK(input != NULL && input->arg_count == 3 && strcmp(input->arg[0].str_arg, "a") == 0 && strcmp(input->arg[1].str_arg, "b") == 0);
+	vex_arg_token* quiet = vex_get_token(&ctx, 1);
+	CHECK(quiet != NULL && quiet->short_name == 'q' && quiet->arg_count == 0);
+	vex_arg_token* out = vex_get_pos(&ctx, 0);
+	CHECK(out->arg_count == 1 && strcmp(out->arg[0].str_arg, "out.txt") == 0);
+
+	// Except inside single quotes, where it's kept as written
+	CHECK(input != NULL && input->arg_count == 3 && strcmp(input->arg[2].str_arg, "x\\\ny") == 0);
+	vex_free(&ctx);
+}
+
+static bool same_hash(vex_ctx* a, int argc_a, char** argv_a, vex_ctx* b, int argc_b, char** argv_b) {
+	vex_hash128 x, y;
+	CHECK(vex_canonical_hash(a, argc_a, argv_a, &x));
+	CHECK(vex_canonical_hash(b, argc_b, argv_b, &y));
+	return x.lo == y.lo && x.hi == y.hi;
+}
+
+static void test_lookup(void) {
+	vex_ctx ctx;
+	vex_init_info info = { "app", "1.0", "Lookup test", 0 };
+	CHECK(vex_init(&ctx, info));
+	add_option(&ctx, "output-dir", 'd', VEX_ARG_TYPE_STR, 1);
+	add_option(&ctx, "output", 'o', VEX_ARG_TYPE_STR, 1);
+	add_option(&ctx, "level", 'l', VEX_ARG_TYPE_INT, 1);
+
+	// An exact name wins over an earlier option that starts with it
+	char* exact[] = { "app", "--output", "a", "--output-dir=b" };
+	CHECK(vex_parse(&ctx, 4, exact));
+	CHECK(vex_token_count(&ctx) == 2);
+	CHECK(strcmp(vex_get_token(&ctx, 0)->long_name, "output") == 0 && strcmp(vex_get_token(&ctx, 0)->arg[0].str_arg, "a") == 0);
+	CHECK(strcmp(vex_get_token(&ctx, 1)->long_name, "output-dir") == 0 && strcmp(vex_get_token(&ctx, 1)->arg[0].str_arg, "b") == 0);
+
+	// Anything else falls back to the first option starting with it, with no ambiguity check
+	char* abbrev[] = { "app", "--lev", "3", "--out", "c" };
+	CHECK(vex_parse(&ctx, 5, abbrev));
+	CHECK(vex_token_count(&ctx) == 2);
+	CHECK(strcmp(vex_get_token(&ctx, 0)->long_name, "level") == 0 && vex_get_token(&ctx, 0)->arg[0].int_arg == 3);
+	CHECK(strcmp(vex_get_token(&ctx, 1)->long_name, "output-dir") == 0);
+	char* unknown[] = { "app", "--levels", "3" };
+	CHECK(!vex_parse(&ctx, 3, unknown));
+	CHECK(ctx.status == VEX_STATUS_UNKNOWN_ARG);
+
+	// Short names go through the character table, which keeps up as the hash index grows
+	char names[20][16];
+	for (int i = 0; i < 20; ++i) {
+		snprintf(names[i], sizeof(names[i]), "extra%d", i);
+		add_option(&ctx, names[i], (char)('A' + i), VEX_ARG_TYPE_INT, 1);
+	}
+	char* shorts[] = { "app", "-T", "19", "-o", "x", "-A", "0", "--extra7", "7" };
+	CHECK(vex_parse(&ctx, 9, shorts));
+	CHECK(vex_token_count(&ctx) == 4);
+	CHECK(strcmp(vex_get_token(&ctx, 0)->long_name, "extra19") == 0 && vex_get_token(&ctx, 0)->arg[0].int_arg == 19);
+	CHECK(strcmp(vex_get_token(&ctx, 1)->long_name, "output") == 0);
+	CHECK(strcmp(vex_get_token(&ctx, 2)->long_name, "extra0") == 0 && vex_get_token(&ctx, 2)->short_name == 'A');
+	CHECK(strcmp(vex_get_token(&ctx, 3)->long_name, "extra7") == 0 && vex_get_token(&ctx, 3)->short_name == 'H');
+	char* bad_short[] = { "app", "-Z", "1" };
+	CHECK(!vex_parse(&ctx, 3, bad_short));
+	CHECK(ctx.status == VEX_STATUS_UNKNOWN_ARG);
+	vex_free(&ctx);
+}
+
+static void test_hash(void) {
+	// Spellings of the same meaning hash the same
+	vex_ctx ctx;
+	setup_pass(&ctx, VEX_FLAG_PASS_UNKNOWN | VEX_FLAG_PASS_REMAINDER);
+	char* cluster[] = { "app", "-abg" };
+	char* separate[] = { "app", "-a", "-b", "-g" };
+	char* reordered[] = { "app", "-g", "-a", "-b" };
+	CHECK(same_hash(&ctx, 2, cluster, &ctx, 4, separate));
+	CHECK(!same_hash(&ctx, 2, cluster, &ctx, 4, reordered));
+	char* attached[] = { "app", "-n3" };
+	char* equals[] = { "app", "--num=3" };
+	char* apart[] = { "app", "--num", "3" };
+	CHECK(same_hash(&ctx, 2, attached, &ctx, 2, equals));
+	CHECK(same_hash(&ctx, 2, attached, &ctx, 3, apart));
+
+	// A forwarded option isn't the same as that word after the separator
+	char* forwarded[] = { "app", "--unk" };
+	char* remainder[] = { "app", "--", "--unk" };
+	CHECK(!same_hash(&ctx, 2, forwarded, &ctx, 3, remainder));
+
+	// The separator alone is kept in the pass-through, so it isn't the same as nothing
+	char* bare[] = { "app" };
+	char* separator[] = { "app", "--" };
+	CHECK(!same_hash(&ctx, 1, bare, &ctx, 2, separator));
+	vex_cache separator_cache;
+	CHECK(vex_cache_init(&separator_cache, 4));
+	const vex_result* cached = vex_cache_parse(&separator_cache, &ctx, 1, bare);
+	CHECK(cached != NULL && cached->pass_argc == 0);
+	cached = vex_cache_parse(&separator_cache, &ctx, 2, separator);
+	CHECK(cached != NULL && cached->pass_argc == 1 && strcmp(cached->pass_argv[0], "--") == 0);
+	CHECK(separator_cache.num_entries == 2);
+	vex_cache_free(&separator_cache);
+
+	// Limits are part of the key
+	vex_hash128 before, after;
+	CHECK(vex_canonical_hash(&ctx, 4, separate, &before));
+	vex_limits limits = { 0 };
+	limits.max_args = 100;
+	vex_set_limits(&ctx, limits);
+	CHECK(vex_canonical_hash(&ctx, 4, separate, &after));
+	CHECK(before.lo != after.lo || before.hi != after.hi);
+	vex_free(&ctx);
+
+	// Schemas of the same shape with different names don't share results
+	vex_ctx a, b;
+	vex_init_info info = { "app", "1.0", "Hash test", 0 };
+	CHECK(vex_init(&a, info));
+	CHECK(vex_init(&b, info));
+	add_option(&a, "foo", 'f', VEX_ARG_TYPE_INT, 1);
+	add_option(&b, "bar", 'b', VEX_ARG_TYPE_INT, 1);
+	char* foo[] = { "app", "--foo=1" };
+	char* bar[] = { "app", "--bar=1" };
+	char* short_foo[] = { "app", "-f", "1" };
+	char* short_bar[] = { "app", "-b", "1" };
+	CHECK(!same_hash(&a, 2, foo, &b, 2, bar));
+	CHECK(!same_hash(&a, 3, short_foo, &b, 3, short_bar));
+
+	vex_cache cache;
+	CHECK(vex_cache_init(&cache, 4));
+	const vex_result* result = vex_cache_parse(&cache, &a, 2, foo);
+	CHECK(result != NULL && strcmp(result->arg_token[0].long_name, "foo") == 0);
+	result = vex_cache_parse(&cache, &b, 2, bar);
+	CHECK(result != NULL && strcmp(result->arg_token[0].long_name, "bar") == 0);
+	CHECK(cache.num_entries == 2);
+
+	// Glob matches depend on the file system, so they're parsed every time
+	vex_arg_desc desc = { 0 };
+	desc.description = "Some files";
+	desc.long_name = "files";
+	desc.short_name = 'g';
+	desc.arg_type = VEX_ARG_TYPE_STR;
+	desc.max_count = -1;
+	desc.flags = VEX_DESC_GLOB;
+	CHECK(vex_add_arg(&a, desc));
+	char* glob[] = { "app", "--files=*.nothing" };
+	CHECK(vex_cache_parse(&cache, &a, 2, glob) != NULL);
+	CHECK(vex_cache_parse(&cache, &a, 2, glob) != NULL);
+	CHECK(cache.num_entries == 2);
+	vex_cache_free(&cache);
+	vex_free(&a);
+	vex_free(&b);
+}
+
+int main(void) {
+	test_positionals();
+	test_passthrough();
+	test_render();
+	test_hash();
+	test_pack();
+	test_json();
+	test_stream();
+	test_words();
+	test_lookup();
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All parse checks passed\n");
+	return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ test_paths.c
+
+ Builds a scratch directory of files, subdirectories and unreadable entries, then checks path values against it.
+ Every input is checked on one thread and on several; both must agree with a plain stat of each path, and the status
+ must name the first failing argument. Glob patterns are expanded against the same directory, in sorted order, with
+ each directory listed once per parse.
+ */
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define VEX_ENABLE_THREADS
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+#define NUM_PATHS 5000
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+static char root[64];
+
+static void make_file(const char* name, mode_t mode) {
+	char path[128];
+	snprintf(path, sizeof(path), "%s/%s", root, name);
+	FILE* file = fopen(path, "w");
+	if (!file) exit(1);
+	fclose(file);
+	chmod(path, mode);
+}
+
+static void setup(vex_ctx* ctx) {
+	vex_init_info info = { "app", "1.0", "Path test", 0 };
+	CHECK(vex_init(ctx, info));
+	vex_arg_desc desc = { 0 };
+	desc.description = "Input files";
+	desc.long_name = "input";
+	desc.short_name = 'i';
+	desc.arg_type = VEX_ARG_TYPE_STR;
+	desc.max_count = -1;
+	desc.flags = VEX_DESC_PATH_FILE | VEX_DESC_PATH_READABLE;
+	CHECK(vex_add_arg(ctx, desc));
+	desc.description = "Output directory";
+	desc.long_name = "out";
+	desc.short_name = 'o';
+	desc.max_count = 1;
+	desc.flags = VEX_DESC_PATH_DIR;
+	CHECK(vex_add_arg(ctx, desc));
+	desc.description = "Unchecked";
+	desc.long_name = "label";
+	desc.short_name = 'l';
+	desc.flags = 0;
+	CHECK(vex_add_arg(ctx, desc));
+	vex_pos_desc pos = { 0 };
+	pos.description = "Anything that exists";
+	pos.name = "extra";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	pos.max_count = -1;
+	pos.flags = VEX_DESC_PATH_EXISTS;
+	CHECK(vex_add_pos(ctx, pos));
+}
+
+static int expected_error(const char* path, int checks) {
+	struct stat info;
+	if (stat(path, &info) != 0) return ENOENT;
+	if ((checks & VEX_DESC_PATH_FILE) && !S_ISREG(info.st_mode)) return S_ISDIR(info.st_mode) ? EISDIR : EINVAL;
+	if ((checks & VEX_DESC_PATH_DIR) && !S_ISDIR(info.st_mode)) return ENOTDIR;
+	if ((checks & VEX_DESC_PATH_READABLE) && access(path, R_OK) != 0) return EACCES;
+	return 0;
+}
+
+static void test_small(void) {
+	vex_ctx ctx;
+	setup(&ctx);
+	char file[128], dir[128], missing[128];
+	snprintf(file, sizeof(file), "%s/a.txt", root);
+	snprintf(dir, sizeof(dir), "%s/sub", root);
+	snprintf(missing, sizeof(missing), "%s/nope", root);
+
+	// Results are kept in argument order and point back at their values
+	char* good[] = { "app", "-i", file, "--out", dir, "-l", missing, dir, file };
+	CHECK(vex_parse(&ctx, 9, good));
+	CHECK(vex_check_paths(&ctx, 0));
+	int count = 0;
+	const vex_path_result* results = vex_get_path_results(&ctx, &count);
+	CHECK(count == 4);
+	CHECK(!results[0].positional && results[0].token == 0 && results[0].value == 0 && results[0].kind == VEX_PATH_FILE);
+	CHECK(results[1].token == 1 && results[1].kind == VEX_PATH_DIR);
+	CHECK(results[2].positional && results[2].token == 0 && results[2].value == 0 && results[2].kind == VEX_PATH_DIR);
+	CHECK(results[3].positional && results[3].value == 1 && results[3].error == 0);
+	CHECK(results[0].path == vex_get_token(&ctx, 0)->arg[0].str_arg);
+
+	// The status names the first failure, the results have all of them
+	char* bad[] = { "app", "-o", file, "-i", dir, missing };
+	CHECK(vex_parse(&ctx, 6, bad));
+	CHECK(!vex_check_paths(&ctx, 1));
+	CHECK(ctx.status == VEX_STATUS_BAD_PATH);
+	CHECK(strncmp(ctx.status_msg, "Invalid path for out: ", 22) == 0);
+	results = vex_get_path_results(&ctx, &count);
+	CHECK(count == 3);
+	CHECK(results[0].error == ENOTDIR && results[1].error == EISDIR && results[2].error == ENOENT);
+	CHECK(results[2].kind == VEX_PATH_MISSING);
+
+	// A suffix parse drops the paths of the suffix it replaces
+	vex_checkpoint checkpoint;
+	char* prefix[] = { "app", "-i", file };
+	char* suffix[] = { dir, dir };
+	CHECK(vex_parse_prefix(&ctx, 3, prefix, &checkpoint));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 2, suffix));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 1, suffix));
+	vex_get_path_results(&ctx, &count);
+	CHECK(count == 2);
+	vex_free(&ctx);
+}
+
+static void test_many(void) {
+	// A mix of good and bad inputs large enough to spread over several threads
+	static char storage[NUM_PATHS][128];
+	static char* argv[NUM_PATHS + 2];
+	static const char* names[] = { "a.txt", "b.txt", "sub", "locked.txt", "nope", "sub/c.txt" };
+	argv[0] = "app";
+	argv[1] = "-i";
+	for (int i = 0; i < NUM_PATHS; ++i) {
+		snprintf(storage[i], sizeof(storage[i]), "%s/%s", root, names[(i * 7) % 6]);
+		argv[i + 2] = storage[i];
+	}
+
+	vex_ctx ctx;
+	setup(&ctx);
+	for (int threads = 1; threads <= 8; threads *= 2) {
+		CHECK(vex_parse(&ctx, NUM_PATHS + 2, argv));
+		vex_check_paths(&ctx, threads);
+		int count = 0;
+		const vex_path_result* results = vex_get_path_results(&ctx, &count);
+		CHECK(count == NUM_PATHS);
+		int mismatches = 0;
+		for (int i = 0; i < count; ++i) {
+			if (results[i].error != expected_error(storage[i], VEX_DESC_PATH_FILE | VEX_DESC_PATH_READABLE)) mismatches++;
+		}
+		CHECK(mismatches == 0);
+	}
+	vex_free(&ctx);
+}
+
+static bool glob_match(const char* pattern, const char* name) {
+	_vex_glob_op ops[64];
+	_vex_glob_part parts[8];
+	CHECK(_vex_glob_compile(pattern, ops, parts) == 1);
+	return _vex_glob_match(ops, parts[0].num_ops, name);
+}
+
+static void check_values(vex_arg_token* token, const char** expected, int count) {
+	CHECK(token != NULL && token->arg_count == count);
+	for (int i = 0; token && i < count && i < token->arg_count; ++i) {
+		char path[128];
+		snprintf(path, sizeof(path), "%s/%s", root, expected[i]);
+		if (strcmp(token->arg[i].str_arg, path) != 0) {
+			fprintf(stderr, "value %d: expected %s, got %s\n", i, path, token->arg[i].str_arg);
+			failures++;
+		}
+	}
+}
+
+static void test_glob(void) {
+	// The matcher on its own
+	CHECK(glob_match("*.txt", "a.txt") && !glob_match("*.txt", "a.txt.bak"));
+	CHECK(glob_match("a*b*c", "aXbYbZc") && !glob_match("a*b*c", "aXbYbZ"));
+	CHECK(glob_match("[a-c]?", "bz") && !glob_match("[a-c]?", "dz") && !glob_match("[!a-c]?", "bz"));
+	CHECK(glob_match("[]x]", "]") && glob_match("[^x]", "y") && glob_match("[ab", "[ab"));
+	CHECK(glob_match("\\*", "*") && !glob_match("\\*", "a"));
+	CHECK(!glob_match("*", ".hidden") && !glob_match("?hidden", ".hidden") && glob_match(".*", ".hidden"));
+
+	vex_ctx ctx;
+	vex_init_info info = { "app", "1.0", "Glob test", 0 };
+	CHECK(vex_init(&ctx, info));
+	vex_arg_desc desc = { 0 };
+	desc.description = "Files";
+	desc.long_name = "files";
+	desc.short_name = 'f';
+	desc.arg_type = VEX_ARG_TYPE_STR;
+	desc.max_count = -1;
+	desc.flags = VEX_DESC_GLOB | VEX_DESC_PATH_EXISTS;
+	CHECK(vex_add_arg(&ctx, desc));
+	vex_pos_desc pos = { 0 };
+	pos.description = "Directories";
+	pos.name = "dirs";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	pos.max_count = -1;
+	pos.flags = VEX_DESC_GLOB;
+	CHECK(vex_add_pos(&ctx, pos));
+
+	char patterns[6][128];
+	const char* forms[] = { "*.txt", "*/c.txt", "[ab].txt", ".*", "*.none", "s?b" };
+	for (int i = 0; i < 6; ++i) snprintf(patterns[i], sizeof(patterns[i]), "%s/%s", root, forms[i]);
+
+	// Matches go into the option's values in sorted order; a pattern matching nothing stays as written
+	char* argv[] = { "app", "-f", patterns[0], patterns[1], patterns[2], patterns[3], patterns[4], "--", patterns[5] };
+	CHECK(vex_parse(&ctx, 9, argv));
+	const char* expected[] = { "a.txt", "b.txt", "locked.txt", "sub/c.txt", "a.txt", "b.txt", ".hidden", "*.none" };
+	check_values(vex_get_token(&ctx, 0), expected, 8);
+	const char* dirs[] = { "sub" };
+	check_values(vex_get_pos(&ctx, 0), dirs, 1);
+	int count = 0;
+	vex_get_path_results(&ctx, &count);
+	CHECK(count == 8);
+
+	// Every directory was read once: the scratch directory and whatever "*" matched there
+	CHECK(ctx.num_dir_cache == 5);
+	char* one[] = { "app", "-f", patterns[1] };
+	CHECK(vex_parse(&ctx, 3, one));
+	CHECK(ctx.num_dir_cache == 5);
+
+	// A suffix parse drops every match of the suffix it replaces
+	vex_checkpoint checkpoint;
+	char* prefix[] = { "app", "-f", patterns[0] };
+	char* suffix[] = { patterns[2], patterns[0] };
+	CHECK(vex_parse_prefix(&ctx, 3, prefix, &checkpoint));
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 2, suffix));
+	CHECK(vex_get_token(&ctx, 0)->arg_count == 8);
+	CHECK(vex_parse_suffix(&ctx, &checkpoint, 1, suffix));
+	CHECK(vex_get_token(&ctx, 0)->arg_count == 5);
+
+	// A trailing slash matches directories only, and escapes are dropped from values without wildcards
+	char dir_pattern[128], escaped[128], deep[256];
+	snprintf(dir_pattern, sizeof(dir_pattern), "%s/*/", root);
+	snprintf(escaped, sizeof(escaped), "%s/\\[a\\].txt", root);
+	char* literal[] = { "app", "--", dir_pattern, escaped };
+	CHECK(vex_parse(&ctx, 4, literal));
+	const char* literal_values[] = { "sub/", "[a].txt" };
+	check_values(vex_get_pos(&ctx, 0), literal_values, 2);
+
+	// Every part after the leading literal ones is a level of recursion, and there's a limit to those
+	int len = snprintf(deep, sizeof(deep), "%s", root);
+	for (int i = 0; i < 70; ++i) len += snprintf(deep + len, sizeof(deep) - (size_t)len, "/*");
+	char* too_deep[] = { "app", "--", deep };
+	CHECK(!vex_parse(&ctx, 3, too_deep));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+
+	// Each match counts against the value limit
+	vex_limits limits = { 0 };
+	limits.max_values = 2;
+	vex_set_limits(&ctx, limits);
+	CHECK(!vex_parse(&ctx, 3, prefix));
+	CHECK(ctx.status == VEX_STATUS_LIMIT_EXCEEDED);
+	vex_free(&ctx);
+}
+
+int main(void) {
+	snprintf(root, sizeof(root), "/tmp/vex_paths_%ld", (long)getpid());
+	char sub[128];
+	snprintf(sub, sizeof(sub), "%s/sub", root);
+	if (mkdir(root, 0700) != 0 || mkdir(sub, 0700) != 0) return 1;
+	make_file("a.txt", 0600);
+	make_file("b.txt", 0600);
+	make_file("locked.txt", 0000);
+	make_file("sub/c.txt", 0600);
+	make_file(".hidden", 0600);
+
+	test_small();
+	test_many();
+	test_glob();
+
+	char path[128];
+	const char* files[] = { "a.txt", "b.txt", "locked.txt", "sub/c.txt", ".hidden" };
+	for (int i = 0; i < 5; ++i) {
+		snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+		remove(path);
+	}
+	rmdir(sub);
+	rmdir(root);
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All path checks passed\n");
+	return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ test_threads.c
+
+ Hammers the query functions of a parsed context from many threads at once. Every round starts with an empty help
+ cache so the threads race to build it; they must all see the same complete text and nothing may leak. A usage table
+ shared by one context per thread must end up with exact counts, and a reused descriptor slot must start from zero.
+ */
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+static long live_blocks = 0;
+
+static void* test_malloc(size_t size) {
+	void* ptr = malloc(size);
+	if (ptr) __atomic_add_fetch(&live_blocks, 1, __ATOMIC_RELAXED);
+	return ptr;
+}
+
+static void* test_realloc(void* ptr, size_t size) {
+	if (!ptr) return test_malloc(size);
+	return realloc(ptr, size);
+}
+
+static void test_free(void* ptr) {
+	if (ptr) __atomic_sub_fetch(&live_blocks, 1, __ATOMIC_RELAXED);
+	free(ptr);
+}
+
+#define VEX_MALLOC test_malloc
+#define VEX_REALLOC test_realloc
+#define VEX_FREE test_free
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+#define NUM_THREADS 8
+#define NUM_ROUNDS 200
+#define NUM_QUERIES 50
+#define NUM_PARSES 2000
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			__atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED); \
+		} \
+	} while (0)
+
+typedef struct {
+	vex_ctx* ctx;
+	const char* expected_help;
+	pthread_barrier_t* barrier;
+} worker_args;
+
+typedef struct {
+	vex_usage* usage;
+	pthread_barrier_t* barrier;
+} usage_args;
+
+static void start_thread(pthread_t* thread, void* (*fn)(void*), void* arg) {
+	if (pthread_create(thread, NULL, fn, arg) != 0) {
+		fprintf(stderr, "pthread_create failed\n");
+		exit(1);
+	}
+}
+
+static void setup(vex_ctx* ctx) {
+	vex_init_info info = { "app", "2.1", "Thread test", 0 };
+	CHECK(vex_init(ctx, info));
+	static const char* names[] = { "input", "output", "threads", "scale", "quiet", "force" };
+	static const char shorts[] = { 'i', 'o', 't', 's', 'q', 'f' };
+	static const int types[] = { VEX_ARG_TYPE_STR, VEX_ARG_TYPE_STR, VEX_ARG_TYPE_INT, VEX_ARG_TYPE_DUB, VEX_ARG_TYPE_FLAG, VEX_ARG_TYPE_FLAG };
+	for (int i = 0; i < 6; ++i) {
+		vex_arg_desc desc = { 0 };
+		desc.description = "Some option with a description";
+		desc.long_name = (char*)names[i];
+		desc.short_name = shorts[i];
+		desc.arg_type = types[i];
+		desc.max_count = (types[i] == VEX_ARG_TYPE_FLAG) ? 0 : 1;
+		CHECK(vex_add_arg(ctx, desc));
+	}
+	vex_pos_desc pos = { 0 };
+	pos.description = "Files to process";
+	pos.name = "files";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	pos.max_count = -1;
+	CHECK(vex_add_pos(ctx, pos));
+
+	char* argv[] = { "app", "-i", "in.txt", "--threads=4", "-q", "a", "b", "c" };
+	CHECK(vex_parse(ctx, 8, argv));
+}
+
+static void* worker(void* arg) {
+	worker_args* args = (worker_args*)arg;
+	vex_ctx* ctx = args->ctx;
+
+	// Start together to make the race for the help cache as tight as possible
+	pthread_barrier_wait(args->barrier);
+	const char* help = vex_get_help(ctx);
+	CHECK(help != NULL && strcmp(help, args->expected_help) == 0);
+	for (int q = 0; q < NUM_QUERIES; ++q) {
+		CHECK(vex_get_help(ctx) == help);
+		CHECK(strcmp(vex_get_version(ctx), "2.1") == 0);
+		CHECK(vex_arg_found(ctx, "input"));
+		CHECK(vex_arg_found(ctx, "q"));
+		CHECK(!vex_arg_found(ctx, "force"));
+		CHECK(vex_token_count(ctx) == 3);
+		vex_arg_token* token = vex_get_token(ctx, 1);
+		CHECK(token != NULL && token->arg_count == 1 && token->arg[0].int_arg == 4);
+		vex_arg_token* pos = vex_get_pos(ctx, 0);
+		CHECK(pos != NULL && pos->arg_count == 3 && strcmp(pos->arg[2].str_arg, "c") == 0);
+	}
+	return NULL;
+}
+
+static void* usage_worker(void* arg) {
+	usage_args* args = (usage_args*)arg;
+	vex_ctx ctx;
+	setup(&ctx);
+	vex_usage_attach(&ctx, args->usage);
+	pthread_barrier_wait(args->barrier);
+	char* argv[] = { "app", "-q", "--input=x", "-i", "y", "--th", "2", "z" };
+	for (int p = 0; p < NUM_PARSES; ++p) CHECK(vex_parse(&ctx, 8, argv));
+	vex_free(&ctx);
+	return NULL;
+}
+
+static void test_usage(void) {
+	vex_ctx schema;
+	setup(&schema);
+	vex_usage usage;
+	CHECK(vex_usage_init(&usage, &schema, 4));
+
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+	pthread_t threads[NUM_THREADS];
+	usage_args args = { &usage, &barrier };
+	for (int t = 0; t < NUM_THREADS; ++t) start_thread(&threads[t], usage_worker, &args);
+	for (int t = 0; t < NUM_THREADS; ++t) pthread_join(threads[t], NULL);
+	pthread_barrier_destroy(&barrier);
+
+	// Descriptors are help, version, then the options from setup in order
+	uint64_t counts[8];
+	CHECK(usage.num_counters == 8);
+	vex_usage_snapshot(&usage, counts);
+	uint64_t parses = (uint64_t)NUM_THREADS * NUM_PARSES;
+	CHECK(counts[0] == 0 && counts[1] == 0);
+	CHECK(counts[2] == 2 * parses);
+	CHECK(counts[3] == 0);
+	CHECK(counts[4] == parses);
+	CHECK(counts[5] == 0);
+	CHECK(counts[6] == parses);
+	CHECK(counts[7] == 0);
+
+	char buffer[256];
+	char expected[256];
+	vex_json_writer writer;
+	vex_json_init_buffer(&writer, buffer, sizeof(buffer) - 1);
+	CHECK(vex_usage_export(&usage, &schema, &writer));
+	buffer[writer.len] = '\0';
+	snprintf(expected, sizeof(expected), "{\"help\":0,\"version\":0,\"input\":%llu,\"output\":0,\"threads\":%llu,\"scale\":0,\"quiet\":%llu,\"force\":0}",
+		(unsigned long long)(2 * parses), (unsigned long long)parses, (unsigned long long)parses);
+	CHECK(strcmp(buffer, expected) == 0);
+
+	// The round-robin turn keeps picking real shards after it wraps
+	usage.next_shard = UINT_MAX - 1;
+	for (int i = 0; i < 4; ++i) {
+		vex_usage_attach(&schema, &usage);
+		ptrdiff_t offset = schema.usage_shard - usage.counters;
+		CHECK(offset >= 0 && offset % usage.stride == 0 && offset / usage.stride < usage.num_shards);
+	}
+	vex_usage_attach(&schema, NULL);
+
+	vex_usage_free(&usage);
+	vex_free(&schema);
+}
+
+static void test_usage_reuse(void) {
+	// Count a group's option in two shards, then remove it and let another group take its slot
+	vex_ctx ctx;
+	setup(&ctx);
+	vex_arg_desc opt = { 0 };
+	opt.long_name = "level";
+	opt.arg_type = VEX_ARG_TYPE_INT;
+	opt.max_count = 1;
+	int group = vex_add_group(&ctx, "old", &opt, 1);
+	CHECK(group >= 0);
+	vex_usage usage;
+	CHECK(vex_usage_init(&usage, &ctx, 4));
+	int slot = usage.num_counters - 1;
+	char* old_argv[] = { "app", "--old.level=1" };
+	for (int s = 0; s < 2; ++s) {
+		vex_usage_attach(&ctx, &usage);
+		CHECK(vex_parse(&ctx, 2, old_argv));
+	}
+	uint64_t counts[16];
+	vex_usage_snapshot(&usage, counts);
+	CHECK(counts[slot] == 2);
+
+	CHECK(vex_remove_group(&ctx, group));
+	vex_usage_snapshot(&usage, counts);
+	CHECK(counts[slot] == 0);
+	CHECK(vex_add_group(&ctx, "new", &opt, 1) >= 0);
+	CHECK(ctx.num_arg_desc == usage.num_counters);
+	char* new_argv[] = { "app", "--new.level=1" };
+	CHECK(vex_parse(&ctx, 2, new_argv));
+	vex_usage_snapshot(&usage, counts);
+	CHECK(counts[slot] == 1);
+
+	vex_free(&ctx);
+	vex_usage_free(&usage);
+}
+
+static void test_help_race(void) {
+	// Reference text from a context nobody else touches
+	vex_ctx reference;
+	setup(&reference);
+	const char* expected_help = vex_get_help(&reference);
+	CHECK(expected_help != NULL);
+
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+	for (int round = 0; round < NUM_ROUNDS; ++round) {
+		vex_ctx ctx;
+		setup(&ctx);
+		pthread_t threads[NUM_THREADS];
+		worker_args args = { &ctx, expected_help, &barrier };
+		for (int t = 0; t < NUM_THREADS; ++t) {
+			start_thread(&threads[t], worker, &args);
+		}
+		for (int t = 0; t < NUM_THREADS; ++t) pthread_join(threads[t], NULL);
+		vex_free(&ctx);
+	}
+	pthread_barrier_destroy(&barrier);
+	vex_free(&reference);
+}
+
+int main(void) {
+	test_help_race();
+	test_usage();
+	test_usage_reuse();
+
+	// Losing threads must have released their copy of the help text
+	CHECK(live_blocks == 0);
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All thread checks passed\n");
+	return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ test_utf8.c
+
+ Compares the UTF-8 validator against a plain decoder on every string of up to three bytes and a wide sample of
+ four byte strings, checks the reported offset where the block-wise ASCII skip hands over, and checks that parsing
+ rejects bad values only for descriptors that asked for validation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VEX_IMPLEMENTATION
+#include "vex/vex.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+static bool reference_valid(const unsigned char* s, size_t len, size_t* offset) {
+	// Decode each code point in full, then reject what RFC 3629 forbids
+	size_t i = 0;
+	while (i < len) {
+		unsigned char c = s[i];
+		size_t n;
+		unsigned long cp, min;
+		if (c < 0x80) { n = 0; cp = c; min = 0; }
+		else if ((c & 0xE0) == 0xC0) { n = 1; cp = c & 0x1F; min = 0x80; }
+		else if ((c & 0xF0) == 0xE0) { n = 2; cp = c & 0x0F; min = 0x800; }
+		else if ((c & 0xF8) == 0xF0) { n = 3; cp = c & 0x07; min = 0x10000; }
+		else break;
+		if (i + n >= len && n > 0) break;
+		size_t k = 1;
+		for (; k <= n && (s[i + k] & 0xC0) == 0x80; ++k) cp = (cp << 6) | (s[i + k] & 0x3F);
+		if (k <= n || cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) break;
+		i += n + 1;
+	}
+	*offset = i;
+	return i == len;
+}
+
+static void compare(const unsigned char* s, size_t len) {
+	size_t expected_offset = 0, offset = 0;
+	bool expected = reference_valid(s, len, &expected_offset);
+	bool valid = _vex_utf8_valid((const char*)s, len, &offset);
+	if (valid != expected || (!valid && offset != expected_offset)) {
+		fprintf(stderr, "mismatch for");
+		for (size_t i = 0; i < len; ++i) fprintf(stderr, " %02x", s[i]);
+		fprintf(stderr, ": expected %d at %lu, got %d at %lu\n", expected, (unsigned long)expected_offset, valid, (unsigned long)offset);
+		failures++;
+	}
+}
+
+static void test_exhaustive(void) {
+	// Every string of one to three bytes
+	unsigned char s[4];
+	for (int a = 0; a < 256; ++a) {
+		s[0] = (unsigned char)a;
+		compare(s, 1);
+		for (int b = 0; b < 256; ++b) {
+			s[1] = (unsigned char)b;
+			compare(s, 2);
+			for (int c = 0; c < 256; ++c) {
+				s[2] = (unsigned char)c;
+				compare(s, 3);
+			}
+		}
+	}
+
+	// Four byte strings after any lead byte, with followers around every boundary that matters
+	static const unsigned char edges[] = { 0x00, 0x41, 0x7f, 0x80, 0x81, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0, 0xc2, 0xe0, 0xf0, 0xf4, 0xff };
+	size_t num_edges = sizeof(edges) / sizeof(edges[0]);
+	for (int a = 0x80; a < 256; ++a) {
+		s[0] = (unsigned char)a;
+		for (size_t b = 0; b < num_edges; ++b) {
+			for (size_t c = 0; c < num_edges; ++c) {
+				for (size_t d = 0; d < num_edges; ++d) {
+					s[1] = edges[b];
+					s[2] = edges[c];
+					s[3] = edges[d];
+					compare(s, 4);
+				}
+			}
+		}
+	}
+}
+
+static void test_offsets(void) {
+	// A bad byte after every length of ASCII, from every alignment, with valid text on both sides
+	static const char* bad[] = { "\xff", "\xc0\x80", "\xe0\x80\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xe2\x82" };
+	char buffer[128];
+	for (size_t b = 0; b < sizeof(bad) / sizeof(bad[0]); ++b) {
+		for (size_t align = 0; align < 16; ++align) {
+			for (size_t prefix = 0; prefix < 48; ++prefix) {
+				char* str = buffer + align;
+				memset(str, 'a', prefix);
+				strcpy(str + prefix, bad[b]);
+				strcat(str, "\xc3\xa9xyz");
+				size_t offset = 0;
+				CHECK(!_vex_utf8_valid(str, strlen(str), &offset));
+				CHECK(offset == prefix);
+
+				// Multi-byte text before the ASCII run moves the offset along with it
+				memcpy(str, "\xe2\x82\xac", prefix >= 3 ? 3 : 0);
+				CHECK(!_vex_utf8_valid(str, strlen(str), &offset));
+				CHECK(offset == prefix);
+			}
+		}
+	}
+	size_t offset = 0;
+	CHECK(_vex_utf8_valid("", 0, &offset));
+	CHECK(_vex_utf8_valid("plain ascii text that spans a few blocks", 40, &offset));
+	CHECK(_vex_utf8_valid("\xf0\x9f\x98\x80 \xe6\x97\xa5\xe6\x9c\xac \xc3\xa9", 14, &offset));
+}
+
+static void test_parse(void) {
+	vex_ctx ctx;
+	vex_init_info info = { "app", "1.0", "UTF-8 test", 0 };
+	CHECK(vex_init(&ctx, info));
+	vex_arg_desc desc = { 0 };
+	desc.description = "Label";
+	desc.long_name = "label";
+	desc.short_name = 'l';
+	desc.arg_type = VEX_ARG_TYPE_STR;
+	desc.max_count = -1;
+	desc.flags = VEX_DESC_UTF8;
+	CHECK(vex_add_arg(&ctx, desc));
+	desc.description = "Raw bytes";
+	desc.long_name = "raw";
+	desc.short_name = 'r';
+	desc.flags = 0;
+	CHECK(vex_add_arg(&ctx, desc));
+	vex_pos_desc pos = { 0 };
+	pos.description = "Name";
+	pos.name = "name";
+	pos.arg_type = VEX_ARG_TYPE_STR;
+	pos.flags = VEX_DESC_UTF8;
+	CHECK(vex_add_pos(&ctx, pos));
+
+	char* good[] = { "app", "--label=caf\xc3\xa9", "-l", "\xe6\x97\xa5", "-r", "\xff\xfe", "--", "\xf0\x9f\x98\x80" };
+	CHECK(vex_parse(&ctx, 8, good));
+	CHECK(ctx.status == VEX_STATUS_OK);
+	CHECK(strcmp(vex_get_pos(&ctx, 0)->arg[0].str_arg, "\xf0\x9f\x98\x80") == 0);
+
+	char* bad_option[] = { "app", "--label=ok", "-l", "caf\xc3(" };
+	CHECK(!vex_parse(&ctx, 4, bad_option));
+	CHECK(ctx.status == VEX_STATUS_BAD_UTF8);
+	CHECK(ctx.status_offset == 3);
+	CHECK(strcmp(ctx.status_msg, "Invalid UTF-8 in label at byte 3") == 0);
+
+	char* bad_pos[] = { "app", "abc\xed\xa0\x80" };
+	CHECK(!vex_parse(&ctx, 2, bad_pos));
+	CHECK(ctx.status == VEX_STATUS_BAD_UTF8);
+	CHECK(ctx.status_offset == 3);
+
+	// Other errors don't carry an offset
+	char* unknown[] = { "app", "--nope" };
+	CHECK(!vex_parse(&ctx, 2, unknown));
+	CHECK(ctx.status == VEX_STATUS_UNKNOWN_ARG);
+	CHECK(ctx.status_offset == 0);
+	vex_free(&ctx);
+}
+
+int main(void) {
+	test_exhaustive();
+	test_offsets();
+	test_parse();
+	if (failures > 0) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All UTF-8 checks passed\n");
+	return 0;
+}